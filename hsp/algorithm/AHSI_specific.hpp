@@ -27,6 +27,7 @@
 // hsp
 #include "../decoder/AHSIData.hpp"
 #include "../utils.hpp"
+#include "./simd.hpp"
 
 namespace hsp {
 
@@ -42,6 +43,18 @@ class GF501A_DBC {
  public:
   using CoeffDataType = float;
   cv::Mat operator()(const AHSIFrame& frame) const {
+    if (frame.data.type() == CV_16UC1 && frame.data.size() == a_.size() &&
+        b_.size() == a_.size()) {
+      // one pass per row: dark term, rounding and saturating subtraction
+      cv::Mat res(frame.data.size(), CV_16UC1);
+      for (int r = 0; r < res.rows; ++r) {
+        simd::radiometric_u16(
+            frame.data.ptr<uint16_t>(r), res.ptr<uint16_t>(r), res.cols,
+            a_.ptr<CoeffDataType>(r), b_.ptr<CoeffDataType>(r),
+            static_cast<CoeffDataType>(frame.index), nullptr, nullptr);
+      }
+      return res;
+    }
     cv::Mat dark;
     cv::Mat tmp = a_ * static_cast<CoeffDataType>(frame.index) + b_;
     tmp.convertTo(dark, cv::DataType<uint16_t>::type);
@@ -12,7 +12,14 @@
 #define HSP_ALGORITHM_OPERATION_HPP_
 
 // C++ Standard
+#include <array>
+#include <cstddef>
+#include <deque>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
 #include <vector>
 
 // OpenCV
@@ -20,6 +27,31 @@
 
 namespace hsp {
 
+namespace detail {
+
+/** @brief 把operator()的结果赋给out。 */
+template <typename T>
+void assign_result_(const T&, T res, T& out) {
+  out = std::move(res);
+}
+
+/**
+ * @brief 把operator()的结果赋给out。
+ *
+ * @details
+ * 结果与输入共享内存（如原样返回输入或其视图）时复制一份，
+ * 以免out成为输入的别名，之后复用out时改写输入。
+ */
+inline void assign_result_(const cv::Mat& in, cv::Mat res, cv::Mat& out) {
+  if (!res.empty() && res.datastart == in.datastart) {
+    res.copyTo(out);
+  } else {
+    out = std::move(res);
+  }
+}
+
+}  // namespace detail
+
 /**
  * @brief 一元图像操作。
  *
@@ -31,6 +63,21 @@ template <typename T>
 class UnaryOperation {
  public:
   virtual T operator()(T) const = 0;
+
+  /**
+   * @brief 把处理结果写入out。
+   *
+   * @details
+   * out的尺寸和类型与结果一致时直接复用其内存，反复处理同样尺寸的数据时不再分配内存。
+   * 默认实现调用operator()，再把结果赋给out，结果与输入共享内存时复制到out；
+   * 辐射校正算法均重写了本函数。
+   *
+   * @param in 输入
+   * @param out 输出
+   */
+  virtual void apply(const T& in, T& out) const {
+    detail::assign_result_(in, operator()(in), out);
+  }
 };
 
 using unary_op = std::shared_ptr<UnaryOperation<cv::Mat>>;
@@ -43,9 +90,355 @@ using unary_op = std::shared_ptr<UnaryOperation<cv::Mat>>;
 template <typename T>
 const auto make_op = std::make_shared<T>;
 
+/**
+ * @brief 把多行块按行切分，依次对每一行调用f。
+ *
+ * @details
+ * 多行块（见ChunkInputIterator）是把连续K行的 bands * samples
+ * 图像纵向堆叠成的 (K * bands) * samples 矩阵。逐行系数的算法借助本函数在整块上运行：
+ * f的参数是第k行在块中的行范围 [k * line_rows, (k + 1) * line_rows)。
+ *
+ * @tparam F 可调用对象，参数为cv::Range
+ * @param rows 块的总行数
+ * @param line_rows 每行影像的行数，即波段数
+ * @param f 对每一行调用的函数
+ */
+template <typename F>
+void for_each_line(int rows, int line_rows, F&& f) {
+  if (line_rows <= 0 || rows % line_rows != 0) {
+    throw std::invalid_argument("chunk is not a whole number of lines");
+  }
+  for (int r = 0; r < rows; r += line_rows) {
+    f(cv::Range(r, r + line_rows));
+  }
+}
+
+/**
+ * @brief 逐行操作适配器，使只能处理单行的操作可以用于多行块。
+ *
+ * @details
+ * 输入行数等于line_rows时直接调用被适配的操作；否则按行切分，结果写入同一个输出块。
+ *
+ */
+class PerLineOperation : public UnaryOperation<cv::Mat> {
+ public:
+  /**
+   * @brief 构造函数。
+   *
+   * @param op 只能处理单行的操作
+   * @param line_rows 每行影像的行数，即波段数
+   */
+  PerLineOperation(unary_op op, int line_rows)
+      : op_{std::move(op)}, line_rows_{line_rows} {}
+
+  cv::Mat operator()(cv::Mat m) const override {
+    cv::Mat res;
+    apply(m, res);
+    return res;
+  }
+
+  void apply(const cv::Mat& m, cv::Mat& out) const override {
+    if (m.rows == line_rows_) {
+      op_->apply(m, out);
+      return;
+    }
+    for_each_line(m.rows, line_rows_, [&](const cv::Range& r) {
+      // write each line into out directly once out has the right shape
+      cv::Mat line = out.rows == m.rows ? out.rowRange(r) : cv::Mat();
+      op_->apply(m.rowRange(r), line);
+      if (r.start == 0) {
+        out.create(m.rows, line.cols, line.type());
+      }
+      if (line.data != out.ptr(r.start)) {
+        line.copyTo(out.rowRange(r));
+      }
+    });
+  }
+
+ private:
+  unary_op op_;
+  int line_rows_;
+};
+
+/**
+ * @brief 构造逐行操作适配器。
+ *
+ * @param op 只能处理单行的操作
+ * @param line_rows 每行影像的行数，即波段数
+ * @return unary_op
+ */
+inline unary_op per_line(unary_op op, int line_rows) {
+  return std::make_shared<PerLineOperation>(std::move(op), line_rows);
+}
+
+/**
+ * @brief 逐像元仿射操作：y = gain * x + offset。
+ *
+ * @details
+ * 系数均为 bands * samples 的矩阵，对单行或多行块中的每一行影像逐像元使用。
+ * 连续的仿射操作可以由hsp::UnaryOpCombo折叠为一个hsp::FusedAffineOperation。
+ */
+class AffineOperation : public UnaryOperation<cv::Mat> {
+ public:
+  /**
+   * @brief 增益系数，新分配的CV_64F矩阵；为空时表示增益为1。
+   *
+   * @return cv::Mat
+   */
+  virtual cv::Mat gain() const = 0;
+
+  /**
+   * @brief 偏移系数，新分配的CV_64F矩阵。
+   *
+   * @return cv::Mat
+   */
+  virtual cv::Mat offset() const = 0;
+
+  /**
+   * @brief 输入深度为input_depth时，输出矩阵的深度。
+   *
+   * @details 整数深度的输出会舍入并饱和，其后的操作不能与本操作折叠。
+   *
+   * @param input_depth 输入矩阵的深度，如CV_16U
+   * @return int
+   */
+  virtual int output_depth(int input_depth) const = 0;
+
+  /**
+   * @brief 系数的版本号，每次载入系数后递增。
+   *
+   * @details hsp::FusedAffineOperation据此判断缓存的折叠结果是否过期。
+   *
+   * @return std::size_t
+   */
+  std::size_t coeff_version() const { return coeff_version_; }
+
+ protected:
+  /** @brief 派生类载入或修改系数后调用。 */
+  void coeff_changed_() { ++coeff_version_; }
+
+ private:
+  std::size_t coeff_version_{0};
+};
+
+/**
+ * @brief 折叠后的连续仿射操作，对每行数据只遍历一遍。
+ *
+ * @details
+ * 中间结果为浮点数时，相邻两个仿射操作的系数预先合并为一组：
+ * g2 * (g1 * x + o1) + o2 = (g1 * g2) * x + (o1 * g2 + o2)，
+ * 与hsp::cuda::GF501A_VN_proc::load()中的折叠相同。
+ * 中间结果为整数时（如暗电平扣除输出uint16），在该处舍入并饱和，与逐个运行的结果一致。
+ * 运行时每一行转换为double，依次应用各组系数后转换为输出类型。
+ *
+ * 行缓冲区为线程局部变量，反复处理同样尺寸的数据时不再分配内存。
+ * 系数在第一次处理某种输入深度的数据时合并并缓存，
+ * 之后任一操作重新载入系数（见AffineOperation::coeff_version()）时重新合并。
+ * 浮点运算的顺序与逐个运行时不同，结果可能相差1个舍入单位。
+ */
+class FusedAffineOperation : public UnaryOperation<cv::Mat> {
+ public:
+  /**
+   * @brief 构造函数。
+   *
+   * @param ops 按运行顺序排列的仿射操作
+   */
+  explicit FusedAffineOperation(
+      std::vector<std::shared_ptr<AffineOperation>> ops)
+      : ops_{std::move(ops)}, cache_{std::make_shared<Cache>()} {}
+
+  cv::Mat operator()(cv::Mat m) const override {
+    cv::Mat res;
+    apply(m, res);
+    return res;
+  }
+
+  void apply(const cv::Mat& m, cv::Mat& out) const override {
+    auto plan = plan_(m.depth());
+    if (plan->bands <= 0 || m.rows % plan->bands != 0) {
+      throw std::invalid_argument("chunk is not a whole number of lines");
+    }
+    if (m.cols != plan->cols) {
+      throw std::invalid_argument("coefficients differ in samples");
+    }
+    thread_local cv::Mat row, tmp;
+    row.create(1, m.cols, CV_64F);
+    out.create(m.size(), CV_MAKETYPE(plan->depth, m.channels()));
+    const std::size_t n_stages = plan->stages.size();
+    for (int r = 0; r < m.rows; ++r) {
+      const int band = r % plan->bands;
+      m.row(r).convertTo(row, CV_64F);
+      double* p = row.ptr<double>();
+      for (std::size_t k = 0; k < n_stages; ++k) {
+        const Stage& stage = plan->stages[k];
+        const double* o = stage.offset.ptr<double>(band);
+        if (stage.gain.empty()) {
+          for (int i = 0; i < m.cols; ++i) {
+            p[i] += o[i];
+          }
+        } else {
+          const double* g = stage.gain.ptr<double>(band);
+          for (int i = 0; i < m.cols; ++i) {
+            p[i] = p[i] * g[i] + o[i];
+          }
+        }
+        if (k + 1 < n_stages && stage.depth != CV_64F) {
+          row.convertTo(tmp, stage.depth);  // round and saturate
+          tmp.convertTo(row, CV_64F);
+        }
+      }
+      cv::Mat dst = out.row(r);
+      row.convertTo(dst, plan->depth);
+    }
+  }
+
+  /**
+   * @brief 返回折叠的操作个数。
+   *
+   * @return std::size_t
+   */
+  std::size_t size() const { return ops_.size(); }
+
+ private:
+  /** @brief 一组合并后的系数，depth为应用后舍入到的深度。 */
+  struct Stage {
+    cv::Mat gain;
+    cv::Mat offset;
+    int depth;
+  };
+
+  /** @brief 某种输入深度下的折叠结果。 */
+  struct Plan {
+    int bands;
+    int cols;
+    int depth;
+    std::vector<Stage> stages;
+    /** @brief 折叠时各操作的系数版本号。 */
+    std::vector<std::size_t> versions;
+  };
+
+  /** @brief 按输入深度缓存的折叠结果，由各个副本共享。 */
+  struct Cache {
+    std::mutex mutex;
+    std::map<int, std::shared_ptr<const Plan>> plans;
+  };
+
+  std::shared_ptr<const Plan> plan_(int input_depth) const {
+    std::lock_guard<std::mutex> lock(cache_->mutex);
+    auto& plan = cache_->plans[input_depth];
+    if (!plan || !up_to_date_(*plan)) {
+      plan = fold_(input_depth);
+    }
+    return plan;
+  }
+
+  bool up_to_date_(const Plan& plan) const {
+    for (std::size_t k = 0; k < ops_.size(); ++k) {
+      if (ops_[k]->coeff_version() != plan.versions[k]) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  std::shared_ptr<const Plan> fold_(int input_depth) const {
+    auto plan = std::make_shared<Plan>();
+    int depth = input_depth;
+    for (auto&& op : ops_) {
+      plan->versions.push_back(op->coeff_version());
+      Stage next{op->gain(), op->offset(), op->output_depth(depth)};
+      if (next.offset.empty() ||
+          (!next.gain.empty() && next.gain.size() != next.offset.size()) ||
+          (!plan->stages.empty() &&
+           next.offset.size() != plan->stages.back().offset.size())) {
+        throw std::invalid_argument("affine coefficients differ in size");
+      }
+      if (!plan->stages.empty() && (depth == CV_32F || depth == CV_64F)) {
+        Stage& last = plan->stages.back();
+        cv::Mat gain, offset;
+        if (next.gain.empty()) {
+          gain = last.gain;
+          offset = last.offset;
+        } else {
+          if (!last.gain.empty()) {
+            cv::multiply(last.gain, next.gain, gain);
+          } else {
+            gain = next.gain;
+          }
+          cv::multiply(last.offset, next.gain, offset);
+        }
+        cv::add(offset, next.offset, offset);
+        last.gain = gain;
+        last.offset = offset;
+        last.depth = next.depth;
+      } else {
+        plan->stages.push_back(next);
+      }
+      depth = next.depth;
+    }
+    if (plan->stages.empty()) {
+      throw std::invalid_argument("no affine operation to fuse");
+    }
+    plan->bands = plan->stages.front().offset.rows;
+    plan->cols = plan->stages.front().offset.cols;
+    plan->depth = depth;
+    return plan;
+  }
+
+  std::vector<std::shared_ptr<AffineOperation>> ops_;
+  std::shared_ptr<Cache> cache_;
+};
+
+namespace detail {
+
+/**
+ * @brief 当前线程中的一对中间缓冲区，供hsp::UnaryOpCombo交替使用。
+ *
+ * @details
+ * 缓冲区按组合器的嵌套深度分配：嵌套的组合器使用不同的缓冲区，
+ * 同一深度先后运行的组合器复用同一对缓冲区，尺寸不变时不再分配内存。
+ */
+class ScratchScope {
+ public:
+  ScratchScope() : depth_{level_()++} {
+    auto& pool = pool_();
+    while (pool.size() <= depth_) {
+      pool.emplace_back();  // deque keeps references of outer levels valid
+    }
+  }
+  ~ScratchScope() { --level_(); }
+  ScratchScope(const ScratchScope&) = delete;
+  ScratchScope& operator=(const ScratchScope&) = delete;
+
+  cv::Mat& operator[](std::size_t k) { return pool_()[depth_][k % 2]; }
+
+ private:
+  static std::size_t& level_() {
+    thread_local std::size_t level = 0;
+    return level;
+  }
+  static std::deque<std::array<cv::Mat, 2>>& pool_() {
+    thread_local std::deque<std::array<cv::Mat, 2>> pool;
+    return pool;
+  }
+
+  std::size_t depth_;
+};
+
+}  // namespace detail
+
 /**
  * @brief 一元操作组合器。
  *
+ * @details
+ * 用set_fusion()开启后，连续两个及以上的仿射操作（hsp::AffineOperation，
+ * 如暗电平扣除和非均匀校正）折叠为一个hsp::FusedAffineOperation，
+ * 每行只遍历一遍，不产生中间矩阵。折叠改变了浮点运算的顺序，
+ * 整数输出（如uint16）与逐个运行最多相差1，浮点输出相差一个舍入单位量级；
+ * 默认不折叠，保证结果与逐个运行逐位一致。
+ *
+ * apply()在当前线程的两个中间缓冲区之间交替运行各个操作，最后一个操作直接写入out，
+ * 稳定后逐行处理不再分配内存。
  */
 class UnaryOpCombo : public UnaryOperation<cv::Mat> {
  public:
@@ -56,13 +449,34 @@ class UnaryOpCombo : public UnaryOperation<cv::Mat> {
    * @return cv::Mat
    */
   cv::Mat operator()(cv::Mat m) const override {
-    cv::Mat res = m;
-    for (auto&& each : ops_) {
-      res = each->operator()(res);
+    if (steps_.empty()) {
+      return m;
     }
+    cv::Mat res;
+    apply(m, res);
     return res;
   }
 
+  /**
+   * @brief 按照添加顺序运行各个操作，结果写入out。
+   *
+   * @param in 输入
+   * @param out 输出，尺寸和类型与结果一致时复用其内存
+   */
+  void apply(const cv::Mat& in, cv::Mat& out) const override {
+    if (steps_.empty()) {
+      in.copyTo(out);
+      return;
+    }
+    detail::ScratchScope scratch;
+    const cv::Mat* src = &in;
+    for (std::size_t k = 0; k + 1 < steps_.size(); ++k) {
+      steps_[k]->apply(*src, scratch[k]);
+      src = &scratch[k];
+    }
+    steps_.back()->apply(*src, out);
+  }
+
   /**
    * @brief 在组合器中添加操作。
    *
@@ -71,6 +485,7 @@ class UnaryOpCombo : public UnaryOperation<cv::Mat> {
    */
   UnaryOpCombo& add(unary_op op) {
     ops_.emplace_back(op);
+    rebuild_();
     return *this;
   }
 
@@ -81,6 +496,19 @@ class UnaryOpCombo : public UnaryOperation<cv::Mat> {
    */
   UnaryOpCombo& remove_back() {
     ops_.pop_back();
+    rebuild_();
+    return *this;
+  }
+
+  /**
+   * @brief 是否折叠连续的仿射操作，默认为false。误差见类说明。
+   *
+   * @param value
+   * @return UnaryOpCombo&
+   */
+  UnaryOpCombo& set_fusion(bool value) {
+    fusion_ = value;
+    rebuild_();
     return *this;
   }
 
@@ -100,7 +528,33 @@ class UnaryOpCombo : public UnaryOperation<cv::Mat> {
   bool empty() const { return ops_.empty(); }
 
  private:
+  void rebuild_() {
+    steps_.clear();
+    std::vector<std::shared_ptr<AffineOperation>> run;
+    auto flush = [&]() {
+      if (run.size() > 1) {
+        steps_.emplace_back(std::make_shared<FusedAffineOperation>(run));
+      } else if (!run.empty()) {
+        steps_.emplace_back(run.front());
+      }
+      run.clear();
+    };
+    for (auto&& op : ops_) {
+      auto affine =
+          fusion_ ? std::dynamic_pointer_cast<AffineOperation>(op) : nullptr;
+      if (affine) {
+        run.push_back(affine);
+      } else {
+        flush();
+        steps_.emplace_back(op);
+      }
+    }
+    flush();
+  }
+
   std::vector<unary_op> ops_;
+  std::vector<unary_op> steps_;
+  bool fusion_{false};
 };
 
 }  // namespace hsp
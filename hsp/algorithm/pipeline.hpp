@@ -0,0 +1,372 @@
+/**
+ * @file pipeline.hpp
+ * @author xiaoyc
+ * @brief 编译期组合的逐像元处理流水线。
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef HSP_ALGORITHM_PIPELINE_HPP_
+#define HSP_ALGORITHM_PIPELINE_HPP_
+
+// C++ Standard
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+
+// OpenCV
+#include <opencv2/core.hpp>
+
+// project
+#include "./operation.hpp"
+
+namespace hsp {
+
+/**
+ * @brief 逐像元处理阶段，用于hsp::pipeline()。
+ *
+ * @details
+ * 每个阶段是满足以下约定的值类型：
+ * - `template <typename In> using output_type`：输入像元类型为In时的输出像元类型；
+ * - `Row row(int band) const`：绑定到第band个波段的系数，返回轻量的行对象，
+ *   行对象的`template <typename V> V operator()(V x, int i) const`计算第i个像元；
+ * - `cv::Size size() const`：系数矩阵的尺寸（samples * bands），没有系数时为空。
+ *
+ * 阶段只保存系数矩阵的头，与构造它的算法共享数据。
+ */
+namespace pixel {
+
+/**
+ * @brief 逐像元减去系数：y = x - m，输出类型与输入相同。
+ *
+ * @tparam T_coeff 系数的数据类型
+ */
+template <typename T_coeff>
+class Subtract {
+ public:
+  template <typename In>
+  using output_type = In;
+
+  struct Row {
+    const T_coeff* m;
+    template <typename V>
+    V operator()(V x, int i) const {
+      return x - static_cast<V>(m[i]);
+    }
+  };
+
+  explicit Subtract(cv::Mat m) : m_{std::move(m)} {}
+
+  Row row(int band) const { return Row{m_.ptr<T_coeff>(band)}; }
+
+  cv::Size size() const { return m_.size(); }
+
+ private:
+  cv::Mat m_;
+};
+
+/**
+ * @brief 逐像元仿射变换：y = a * x + b，输出类型为T_out。
+ *
+ * @tparam T_out 输出像元的数据类型
+ * @tparam T_coeff 系数的数据类型
+ */
+template <typename T_out, typename T_coeff>
+class Affine {
+ public:
+  template <typename In>
+  using output_type = T_out;
+
+  struct Row {
+    const T_coeff* a;
+    const T_coeff* b;
+    template <typename V>
+    V operator()(V x, int i) const {
+      return x * static_cast<V>(a[i]) + static_cast<V>(b[i]);
+    }
+  };
+
+  Affine(cv::Mat a, cv::Mat b) : a_{std::move(a)}, b_{std::move(b)} {
+    if (a_.size() != b_.size()) {
+      throw std::invalid_argument("affine coefficients differ in size");
+    }
+  }
+
+  Row row(int band) const {
+    return Row{a_.ptr<T_coeff>(band), b_.ptr<T_coeff>(band)};
+  }
+
+  cv::Size size() const { return a_.size(); }
+
+ private:
+  cv::Mat a_;
+  cv::Mat b_;
+};
+
+/**
+ * @brief 截断到[lo, hi]，输出类型为T。
+ *
+ * @tparam T 输出像元的数据类型
+ */
+template <typename T>
+class Clamp {
+ public:
+  template <typename In>
+  using output_type = T;
+
+  struct Row {
+    double lo;
+    double hi;
+    template <typename V>
+    V operator()(V x, int) const {
+      return std::min(std::max(x, static_cast<V>(lo)), static_cast<V>(hi));
+    }
+  };
+
+  Clamp(double lo, double hi) : lo_{lo}, hi_{hi} {}
+
+  Row row(int) const { return Row{lo_, hi_}; }
+
+  cv::Size size() const { return cv::Size(); }
+
+ private:
+  double lo_;
+  double hi_;
+};
+
+/**
+ * @brief 构造截断阶段。
+ *
+ * @tparam T 输出像元的数据类型
+ * @param lo 下限，缺省为T的最小值
+ * @param hi 上限，缺省为T的最大值
+ * @return Clamp<T>
+ */
+template <typename T>
+Clamp<T> clamp(double lo = std::numeric_limits<T>::lowest(),
+               double hi = std::numeric_limits<T>::max()) {
+  return Clamp<T>(lo, hi);
+}
+
+}  // namespace pixel
+
+namespace detail {
+
+/**
+ * @brief 逐像元阶段的编译期链表，依次应用各阶段。
+ *
+ * @details
+ * 阶段的输出类型为整数时，在该处舍入并饱和，与逐个运行的算法一致。
+ */
+template <typename TWork, typename... Stages>
+class StageChain {
+ public:
+  template <typename In>
+  using output_type = In;
+
+  struct Row {
+    template <typename In>
+    TWork apply(TWork x, int) const {
+      return x;
+    }
+  };
+
+  Row row(int) const { return Row(); }
+
+  void collect_size(cv::Size&) const {}
+};
+
+template <typename TWork, typename S, typename... Rest>
+class StageChain<TWork, S, Rest...> {
+  using Tail = StageChain<TWork, Rest...>;
+
+ public:
+  template <typename In>
+  using output_type = typename Tail::template output_type<
+      typename S::template output_type<In>>;
+
+  struct Row {
+    typename S::Row head;
+    typename Tail::Row tail;
+
+    template <typename In>
+    TWork apply(TWork x, int i) const {
+      using Out = typename S::template output_type<In>;
+      x = static_cast<TWork>(cv::saturate_cast<Out>(head(x, i)));
+      return tail.template apply<Out>(x, i);
+    }
+  };
+
+  explicit StageChain(S head, Rest... rest)
+      : head_{std::move(head)}, tail_{std::move(rest)...} {}
+
+  Row row(int band) const { return Row{head_.row(band), tail_.row(band)}; }
+
+  void collect_size(cv::Size& size) const {
+    const cv::Size s = head_.size();
+    if (s.area() > 0) {
+      if (size.area() > 0 && size != s) {
+        throw std::invalid_argument("stage coefficients differ in size");
+      }
+      size = s;
+    }
+    tail_.collect_size(size);
+  }
+
+ private:
+  S head_;
+  Tail tail_;
+};
+
+/** @brief 已经是逐像元阶段的对象原样返回。 */
+template <typename T>
+T to_stage_(const T& stage, long) {  // NOLINT
+  return stage;
+}
+
+/** @brief 提供pixel_stage()的算法（如暗电平扣除、非均匀校正）转换为逐像元阶段。 */
+template <typename T>
+auto to_stage_(const T& op, int) -> decltype(op.pixel_stage()) {
+  return op.pixel_stage();
+}
+
+/** @brief 由make_op()构造的算法指针转换为逐像元阶段。 */
+template <typename T>
+auto to_stage_(const std::shared_ptr<T>& op, int)
+    -> decltype(op->pixel_stage()) {
+  return op->pixel_stage();
+}
+
+template <typename T>
+auto to_stage(const T& x) -> decltype(to_stage_(x, 0)) {
+  return to_stage_(x, 0);
+}
+
+}  // namespace detail
+
+/**
+ * @brief 编译期组合的逐像元处理流水线。
+ *
+ * @details
+ * 各阶段在编译期组合为一个逐像元函数，每行只遍历一遍，不产生中间矩阵，
+ * 也没有逐个操作的虚函数调用，编译器可以内联并向量化内层循环。
+ * 像元先转换为TWork计算，按各阶段的输出类型舍入、饱和，最后写入输出类型。
+ * 输出类型由输入类型和各阶段在编译期推导。
+ *
+ * Pipeline本身是一元操作，可以加入hsp::UnaryOpCombo，与运行时配置的操作组合。
+ * 支持单行及多行块（行数为波段数的整数倍）。
+ *
+ * @tparam TWork 计算使用的数据类型
+ * @tparam Stages 逐像元阶段，见hsp::pixel
+ */
+template <typename TWork, typename... Stages>
+class Pipeline : public UnaryOperation<cv::Mat> {
+ public:
+  /**
+   * @brief 构造函数。
+   *
+   * @param stages 按运行顺序排列的逐像元阶段
+   */
+  explicit Pipeline(Stages... stages) : chain_{std::move(stages)...} {
+    chain_.collect_size(size_);
+  }
+
+  cv::Mat operator()(cv::Mat m) const override {
+    cv::Mat res;
+    apply(m, res);
+    return res;
+  }
+
+  void apply(const cv::Mat& m, cv::Mat& out) const override {
+    switch (m.depth()) {
+      case CV_8U:
+        return run<uint8_t>(m, out);
+      case CV_16U:
+        return run<uint16_t>(m, out);
+      case CV_16S:
+        return run<int16_t>(m, out);
+      case CV_32S:
+        return run<int32_t>(m, out);
+      case CV_32F:
+        return run<float>(m, out);
+      case CV_64F:
+        return run<double>(m, out);
+      default:
+        throw std::invalid_argument("unsupported depth");
+    }
+  }
+
+  /**
+   * @brief 以输入像元类型TIn处理m，结果写入out。
+   *
+   * @tparam TIn 输入像元的数据类型，需与m的深度一致
+   * @param m 单行或多行块
+   * @param out 输出，尺寸和类型一致时复用其内存
+   */
+  template <typename TIn>
+  void run(const cv::Mat& m, cv::Mat& out) const {
+    using TOut = typename detail::StageChain<TWork, Stages...>::template
+        output_type<TIn>;
+    const bool has_coeff = size_.area() > 0;
+    const int bands = has_coeff ? size_.height : std::max(m.rows, 1);
+    if (m.rows % bands != 0) {
+      throw std::invalid_argument("chunk is not a whole number of lines");
+    }
+    if (has_coeff && m.cols != size_.width) {
+      throw std::invalid_argument("coefficients differ in samples");
+    }
+    out.create(m.size(), cv::DataType<TOut>::type);
+    for (int r = 0; r < m.rows; ++r) {
+      const auto row = chain_.row(r % bands);
+      const TIn* src = m.ptr<TIn>(r);
+      TOut* dst = out.ptr<TOut>(r);
+      for (int i = 0; i < m.cols; ++i) {
+        dst[i] = cv::saturate_cast<TOut>(
+            row.template apply<TIn>(static_cast<TWork>(src[i]), i));
+      }
+    }
+  }
+
+ private:
+  detail::StageChain<TWork, Stages...> chain_;
+  cv::Size size_;
+};
+
+/**
+ * @brief 构造逐像元处理流水线。
+ *
+ * @details
+ * 参数可以是hsp::pixel中的阶段，也可以是提供pixel_stage()的算法对象或其指针：
+ *
+ * @code{.cpp}
+ *  auto dbc = hsp::make_op<hsp::DarkBackgroundCorrection<uint16_t>>();
+ *  dbc->load(dark);
+ *  auto nuc = hsp::make_op<hsp::NonUniformityCorrection<uint16_t>>();
+ *  nuc->load(rel_a, rel_b);
+ *  auto ops = hsp::pipeline(dbc, nuc, hsp::pixel::clamp<uint16_t>(0, 4095));
+ *  std::transform(beg, end, obeg, ops);
+ * @endcode
+ *
+ * 阶段与算法共享系数，因此需要在构造流水线之前载入系数。
+ *
+ * @tparam TWork 计算使用的数据类型，缺省为double，系数为double的算法
+ * （如NonUniformityCorrection<double, double>）不损失精度；
+ * 系数均为float时可指定为float，向量化的吞吐量更高
+ * @param ops 按运行顺序排列的阶段或算法
+ * @return Pipeline
+ */
+template <typename TWork = double, typename... Ops>
+auto pipeline(const Ops&... ops)
+    -> Pipeline<TWork, decltype(detail::to_stage(ops))...> {
+  return Pipeline<TWork, decltype(detail::to_stage(ops))...>(
+      detail::to_stage(ops)...);
+}
+
+}  // namespace hsp
+
+#endif  // HSP_ALGORITHM_PIPELINE_HPP_
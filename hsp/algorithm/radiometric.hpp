@@ -36,6 +36,8 @@
 #include "../gdalex.hpp"
 #include "../utils.hpp"
 #include "./operation.hpp"
+#include "./pipeline.hpp"
+#include "./simd.hpp"
 
 namespace hsp {
 
@@ -44,12 +46,55 @@ namespace hsp {
  *
  * @tparam T 载入系数的像元数据类型
  *
- * @note 配合行迭代器使用。
+ * @note 配合行迭代器或多行块迭代器使用。
  */
 template <typename T_coeff = float>
-class DarkBackgroundCorrection : public UnaryOperation<cv::Mat> {
+class DarkBackgroundCorrection : public AffineOperation {
  public:
-  cv::Mat operator()(cv::Mat m) const override { return m - m_; }
+  cv::Mat operator()(cv::Mat m) const override {
+    cv::Mat res;
+    apply(m, res);
+    return res;
+  }
+
+  void apply(const cv::Mat& m, cv::Mat& out) const override {
+    out.create(m.size(), m.type());
+    if (m.type() == CV_16UC1 && m_.type() == CV_16UC1 && m.cols == m_.cols &&
+        m.rows % m_.rows == 0) {
+      for (int r = 0; r < m.rows; ++r) {
+        simd::subtract_u16(m.ptr<uint16_t>(r), m_.ptr<uint16_t>(r % m_.rows),
+                           out.ptr<uint16_t>(r), m.cols);
+      }
+      return;
+    }
+    if (m.rows == m_.rows) {
+      cv::subtract(m, m_, out, cv::noArray(), m.depth());
+      return;
+    }
+    for_each_line(m.rows, m_.rows, [&](const cv::Range& r) {
+      cv::Mat dst = out.rowRange(r);
+      cv::subtract(m.rowRange(r), m_, dst, cv::noArray(), m.depth());
+    });
+  }
+
+  cv::Mat gain() const override { return cv::Mat(); }
+
+  cv::Mat offset() const override {
+    cv::Mat res;
+    m_.convertTo(res, CV_64F, -1);
+    return res;
+  }
+
+  int output_depth(int input_depth) const override { return input_depth; }
+
+  /**
+   * @brief 转换为逐像元阶段，见hsp::pipeline()。
+   *
+   * @return pixel::Subtract<T_coeff>
+   */
+  pixel::Subtract<T_coeff> pixel_stage() const {
+    return pixel::Subtract<T_coeff>(m_);
+  }
 
   /**
    * @brief 载入暗电平系数文件。
@@ -62,6 +107,7 @@ class DarkBackgroundCorrection : public UnaryOperation<cv::Mat> {
     // } else {
     //   m_ = load_text<T>(filename.c_str());
     // }
+    coeff_changed_();
   }
 
  private:
@@ -74,18 +120,71 @@ class DarkBackgroundCorrection : public UnaryOperation<cv::Mat> {
  * @tparam T_out 算法输出的像元数据类型
  * @tparam T_coeff 载入系数的像元数据类型
  *
- * @note 配合行迭代器使用
+ * @note 配合行迭代器或多行块迭代器使用
  */
 template <typename T_out, typename T_coeff = float>
-class NonUniformityCorrection : public UnaryOperation<cv::Mat> {
+class NonUniformityCorrection : public AffineOperation {
  public:
   cv::Mat operator()(cv::Mat m) const override {
     cv::Mat res;
-    m.convertTo(m, cv::DataType<T_coeff>::type);
-    m = m.mul(a_) + b_;
-    m.convertTo(res, cv::DataType<T_out>::type);
+    apply(m, res);
+    return res;
+  }
+
+  void apply(const cv::Mat& m, cv::Mat& out) const override {
+    if (m.type() == CV_16UC1 && cv::DataType<T_out>::type == CV_16UC1 &&
+        a_.type() == CV_32FC1 && b_.type() == CV_32FC1 && m.cols == a_.cols &&
+        m.rows % a_.rows == 0) {
+      // uint16 -> float gain/offset -> saturated uint16 in a single pass
+      out.create(m.size(), CV_16UC1);
+      for (int r = 0; r < m.rows; ++r) {
+        const int band = r % a_.rows;
+        simd::radiometric_u16(m.ptr<uint16_t>(r), out.ptr<uint16_t>(r), m.cols,
+                              nullptr, nullptr, 0, a_.ptr<float>(band),
+                              b_.ptr<float>(band));
+      }
+      return;
+    }
+    // compute in out directly when the output is T_coeff, otherwise in a
+    // per-thread buffer that is reused across calls
+    thread_local cv::Mat buffer;
+    const bool direct =
+        cv::DataType<T_out>::depth == cv::DataType<T_coeff>::depth;
+    cv::Mat& work = direct ? out : buffer;
+    m.convertTo(work, cv::DataType<T_coeff>::type);
+    for_each_line(work.rows, a_.rows, [&](const cv::Range& r) {
+      cv::Mat line = work.rowRange(r);
+      cv::multiply(line, a_, line);
+      cv::add(line, b_, line);
+    });
+    if (!direct) {
+      work.convertTo(out, cv::DataType<T_out>::type);
+    }
+  }
+
+  cv::Mat gain() const override {
+    cv::Mat res;
+    a_.convertTo(res, CV_64F);
+    return res;
+  }
+
+  cv::Mat offset() const override {
+    cv::Mat res;
+    b_.convertTo(res, CV_64F);
     return res;
   }
+
+  int output_depth(int) const override { return cv::DataType<T_out>::depth; }
+
+  /**
+   * @brief 转换为逐像元阶段，见hsp::pipeline()。
+   *
+   * @return pixel::Affine<T_out, T_coeff>
+   */
+  pixel::Affine<T_out, T_coeff> pixel_stage() const {
+    return pixel::Affine<T_out, T_coeff>(a_, b_);
+  }
+
   /**
    * @brief 载入非均匀系数。
    *
@@ -103,6 +202,7 @@ class NonUniformityCorrection : public UnaryOperation<cv::Mat> {
     } else {
       b_ = load_raster<T_coeff>(coeff_b.c_str());
     }
+    coeff_changed_();
   }
 
  private:
@@ -123,11 +223,14 @@ class AbsoluteRadiometricCorrection : public UnaryOperation<cv::Mat> {
  public:
   cv::Mat operator()(cv::Mat m) const override {
     cv::Mat res;
-    m.convertTo(m, cv::DataType<T_coeff>::type);
-    // m = m.mul(a_) + b_;
-    m.convertTo(res, cv::DataType<T_out>::type);
+    apply(m, res);
     return res;
   }
+
+  void apply(const cv::Mat& m, cv::Mat& out) const override {
+    // m = m.mul(a_) + b_;
+    m.convertTo(out, cv::DataType<T_out>::type);
+  }
   void load(const std::string& filename) {}
 
  private:
@@ -143,9 +246,13 @@ class GaussianFilter : public UnaryOperation<cv::Mat> {
  public:
   cv::Mat operator()(cv::Mat m) const override {
     cv::Mat res;
-    cv::GaussianBlur(m, res, cv::Size(3, 3), 0, 0);
+    apply(m, res);
     return res;
   }
+
+  void apply(const cv::Mat& m, cv::Mat& out) const override {
+    cv::GaussianBlur(m, out, cv::Size(3, 3), 0, 0);
+  }
 };
 
 /**
@@ -258,14 +365,18 @@ class DefectivePixelCorrectionSpectral : public UnaryOperation<cv::Mat> {
  public:
   cv::Mat operator()(cv::Mat img) const override {
     cv::Mat res;
+    apply(img, res);
+    return res;
+  }
+
+  void apply(const cv::Mat& img, cv::Mat& out) const override {
     switch (inpaint_) {
       case Inpaint::NEIGHBORHOOD_AVERAGING:
-        res = neighborhood_averaging(img, dpm_);
+        neighborhood_averaging(img, dpm_).copyTo(out);
         break;
       default:
-        cv::inpaint(img, dpm_, res, radius, cv::INPAINT_TELEA);
+        cv::inpaint(img, dpm_, out, radius, cv::INPAINT_TELEA);
     }
-    return res;
   }
 
   /**
@@ -304,6 +415,21 @@ class DefectivePixelCorrectionIDW : public UnaryOperation<cv::Mat> {
 
  public:
   cv::Mat operator()(cv::Mat img) const override {
+    cv::Mat res;
+    apply(img, res);
+    return res;
+  }
+
+  /**
+   * @brief 修复盲元，结果写入out。
+   *
+   * @details 先把img复制到out，再逐个修复out中的盲元，不修改img。
+   *
+   * @param img 输入行
+   * @param out 输出行
+   */
+  void apply(const cv::Mat& img, cv::Mat& out) const override {
+    img.copyTo(out);
     cv::Mat img_1d, padded;
     if (img.type() != CV_32F) {
       img.convertTo(img_1d, CV_32F);
@@ -406,16 +532,15 @@ class DefectivePixelCorrectionIDW : public UnaryOperation<cv::Mat> {
           idw_mid_row.setTo(cv::Scalar::all(0.0), isInvalid(mean_spb));
           patch_alt = get_patch(window2.mul(mean_spb), idw_mid_row);
         }
-        img.at<uint16_t>(defective_pixel) =
+        out.at<uint16_t>(defective_pixel) =
             (patch_alt != 0) ? patch_alt : patch;
 #ifdef __DEBUG__
         spdlog::debug("({}, {}), patch={}, patch_alt={}, final={}, repaired={}",
                       defective_pixel.y, defective_pixel.x, patch, patch_alt,
-                      img.at<uint16_t>(defective_pixel), repaired);
+                      out.at<uint16_t>(defective_pixel), repaired);
 #endif
       }
     });
-    return img;
   }
 
   void load(const std::string& filename) {
@@ -0,0 +1,250 @@
+/**
+ * @file concurrency.hpp
+ * @author xiaoyc
+ * @brief 并发处理所需的基础设施。
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef HSP_CONCURRENCY_HPP_
+#define HSP_CONCURRENCY_HPP_
+
+// C++ Standard
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Boost
+#include <boost/optional.hpp>
+
+namespace hsp {
+
+/**
+ * @brief 等待策略：先让出时间片若干次，仍需等待时改为短暂休眠，避免长时间空转占用CPU。
+ *
+ */
+class Backoff {
+ public:
+  void operator()() {
+    if (count_ < 64) {
+      ++count_;
+      std::this_thread::yield();
+    } else {
+      std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+  }
+
+ private:
+  int count_{0};
+};
+
+/**
+ * @brief 有界无锁单生产者单消费者（SPSC）环形队列。
+ *
+ * @tparam T 元素类型，需要可默认构造和移动赋值
+ *
+ * @details
+ * 只允许一个线程调用push/try_push，另一个线程调用pop/try_pop。
+ * 读写位置分别只由消费者和生产者修改，通过acquire/release语义同步，不使用互斥锁。
+ */
+template <typename T>
+class SPSCRing {
+ public:
+  /**
+   * @brief 构造函数。
+   *
+   * @param capacity 队列容量，至少为1
+   */
+  explicit SPSCRing(std::size_t capacity)
+      : buffer_(std::max<std::size_t>(capacity, 1) + 1) {}
+
+  SPSCRing(const SPSCRing&) = delete;
+  SPSCRing& operator=(const SPSCRing&) = delete;
+
+  /**
+   * @brief 尝试入队。仅由生产者调用。
+   *
+   * @param value 待入队的元素，仅在入队成功时被移走
+   * @return true 入队成功
+   * @return false 队列已满
+   */
+  bool try_push(T& value) {
+    const std::size_t tail = tail_.load(std::memory_order_relaxed);
+    const std::size_t next = increment_(tail);
+    if (next == head_.load(std::memory_order_acquire)) {
+      return false;
+    }
+    buffer_[tail] = std::move(value);
+    tail_.store(next, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * @brief 尝试出队。仅由消费者调用。
+   *
+   * @param value 出队的元素
+   * @return true 出队成功
+   * @return false 队列为空
+   */
+  bool try_pop(T& value) {
+    const std::size_t head = head_.load(std::memory_order_relaxed);
+    if (head == tail_.load(std::memory_order_acquire)) {
+      return false;
+    }
+    value = std::move(buffer_[head]);
+    head_.store(increment_(head), std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * @brief 入队，队列满时等待。
+   *
+   */
+  void push(T value) {
+    Backoff backoff;
+    while (!try_push(value)) {
+      backoff();
+    }
+  }
+
+  /**
+   * @brief 出队，队列空时等待。
+   *
+   */
+  T pop() {
+    T value;
+    Backoff backoff;
+    while (!try_pop(value)) {
+      backoff();
+    }
+    return value;
+  }
+
+  /**
+   * @brief 队列容量。
+   *
+   * @return std::size_t
+   */
+  std::size_t capacity() const { return buffer_.size() - 1; }
+
+  /**
+   * @brief 队列是否为空。
+   *
+   */
+  bool empty() const {
+    return head_.load(std::memory_order_acquire) ==
+           tail_.load(std::memory_order_acquire);
+  }
+
+ private:
+  std::vector<T> buffer_;
+  // keep the two indices on separate cache lines
+  char pad0_[64];
+  std::atomic<std::size_t> head_{0};
+  char pad1_[64];
+  std::atomic<std::size_t> tail_{0};
+  char pad2_[64];
+
+ private:
+  std::size_t increment_(std::size_t i) const {
+    return i + 1 == buffer_.size() ? 0 : i + 1;
+  }
+};
+
+/**
+ * @brief 后台顺序预取器。
+ *
+ * @tparam T 元素类型，需要可移动构造和移动赋值，不要求可默认构造（如hsp::AHSIFrame）
+ *
+ * @details
+ * 后台线程依次调用produce(first), produce(first + 1), ..., produce(last - 1)，
+ * 结果放入容量为depth的SPSCRing；消费者通过pop()按顺序取出，生产与消费重叠进行。
+ * produce抛出的异常在消费者取到对应位置时重新抛出，之后不再生产。
+ * 析构时通知后台线程停止并等待其退出，未取出的元素被丢弃。
+ */
+template <typename T>
+class Prefetcher {
+ public:
+  /**
+   * @brief 构造函数。构造后立即开始预取。
+   *
+   * @param first 起始序号
+   * @param last 结束序号（不含）
+   * @param depth 预取的元素个数
+   * @param produce 生成第i个元素的函数，在后台线程中调用
+   */
+  Prefetcher(int first, int last, std::size_t depth,
+             std::function<T(int)> produce)
+      : ring_(depth), produce_{std::move(produce)} {
+    worker_ = std::thread([this, first, last] { run_(first, last); });
+  }
+
+  Prefetcher(const Prefetcher&) = delete;
+  Prefetcher& operator=(const Prefetcher&) = delete;
+
+  ~Prefetcher() {
+    stop_ = true;
+    if (worker_.joinable()) {
+      worker_.join();
+    }
+  }
+
+  /**
+   * @brief 按顺序取出下一个元素，尚未生产时等待。
+   *
+   * @return T
+   */
+  T pop() {
+    Item item = ring_.pop();
+    if (item.error) {
+      std::rethrow_exception(item.error);
+    }
+    return std::move(*item.value);
+  }
+
+ private:
+  struct Item {
+    boost::optional<T> value;
+    std::exception_ptr error;
+  };
+
+  SPSCRing<Item> ring_;
+  std::function<T(int)> produce_;
+  std::atomic<bool> stop_{false};
+  std::thread worker_;
+
+ private:
+  void run_(int first, int last) {
+    for (int i = first; i < last && !stop_; ++i) {
+      Item item;
+      try {
+        item.value = produce_(i);
+      } catch (...) {
+        item.error = std::current_exception();
+      }
+      const bool failed = static_cast<bool>(item.error);
+      Backoff backoff;
+      while (!ring_.try_push(item)) {
+        if (stop_) {
+          return;
+        }
+        backoff();
+      }
+      if (failed) {
+        return;
+      }
+    }
+  }
+};
+
+}  // namespace hsp
+
+#endif  // HSP_CONCURRENCY_HPP_
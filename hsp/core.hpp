@@ -11,9 +11,16 @@
 #ifndef HSP_CORE_HPP_
 #define HSP_CORE_HPP_
 
+#include "./concurrency.hpp"
+#include "./executor.hpp"
 #include "./gdal_traits.hpp"
 #include "./gdalex.hpp"
+#include "./interleave.hpp"
+#include "./io_config.hpp"
 #include "./iterator.hpp"
+#include "./partition.hpp"
+#include "./raw_cube.hpp"
+#include "./sample_cache.hpp"
 #include "./utils.hpp"
 
 #endif  // HSP_CORE_HPP_
@@ -12,15 +12,21 @@
 #define HSP_DECODER_AHSIDATA_HPP_
 
 // C++ Standard Library
+#include <algorithm>
 #include <fstream>
 #include <memory>
+#include <stdexcept>
 #include <string>
+#include <utility>
+#include <vector>
 
 // Boost
 #include <boost/endian/conversion.hpp>
+#include <boost/filesystem.hpp>
 
 // hsp
 #include "./IRawData.hpp"
+#include "./marker.hpp"
 
 namespace hsp {
 
@@ -31,21 +37,31 @@ namespace hsp {
 struct AHSIFrame {
   AHSIFrame() = delete;
 
-  AHSIFrame(const cv::Mat& d, uint32_t i) : data(d), index{i} {}
+  AHSIFrame(const cv::Mat& d, uint32_t i, bool v = true)
+      : data(d), index{i}, valid{v} {}
 
-  AHSIFrame(const AHSIFrame& other) : data{other.data}, index{other.index} {}
+  AHSIFrame(const AHSIFrame& other)
+      : data{other.data}, index{other.index}, valid{other.valid} {}
 
   /**
    * @brief 帧图像数据。DN值以16位无符号整型存储。
    *
+   * @note
+   * 以ReadMode::Mapped方式读取时，data是内存映射区域上的视图，行间距（step）为原始数据中一个波段的字节数。
    */
-  const cv::Mat& data;
+  cv::Mat data;
 
   /**
    * @brief 帧序列号。
    *
    */
   uint32_t index;
+
+  /**
+   * @brief 帧是否有效。重同步模式下，原始数据中缺失的帧以填充值补齐，该标志为false。
+   *
+   */
+  bool valid;
 };
 
 /**
@@ -71,18 +87,52 @@ class AHSIData : public IRawData<AHSIFrame> {
   /** @brief 帧引导头。 */
   const char leading_bytes[4] = {0x09, 0x15, static_cast<char>(0xC0), 0x00};
 
+  /**
+   * @brief 压缩帧解码器接口。
+   *
+   * @details
+   * 设置解码器后，非直通模式的数据按变长帧处理：每帧从帧引导头开始，到下一帧的引导字节之前结束，
+   * 行头之后的全部字节作为压缩数据交给解码器。
+   */
+  class FrameDecoder {
+   public:
+    virtual ~FrameDecoder() = default;
+
+    /**
+     * @brief 解码一帧压缩数据。
+     *
+     * @note 会在多个线程中同时调用，实现必须是线程安全的。
+     *
+     * @param payload 压缩数据起始地址（第一个波段行头之后）
+     * @param size 压缩数据字节数
+     * @param compress 压缩模式
+     * @param out 输出帧，已分配为 bands * samples
+     * 的16位无符号整型矩阵（可能是更大矩阵的一部分），必须原地写入
+     */
+    virtual void operator()(const char* payload, size_t size,
+                            Compress compress, cv::Mat& out) const = 0;
+  };
+
  public:
   /**
    * @brief 构造函数。
    *
    * @param datafile 0级数据路径。
+   * @param mode 读取方式。ReadMode::Mapped 方式下帧数据直接指向映射区域，不产生复制。
    */
-  explicit AHSIData(const std::string& datafile) : IRawData(datafile) {}
+  explicit AHSIData(const std::string& datafile,
+                    ReadMode mode = ReadMode::Stream)
+      : IRawData(datafile, mode) {}
 
   /**
    * @brief
    * 遍历整个0级数据文件，更新传感器类型（VNIR、SWIR），图像尺寸（samples、lines、bands）等信息。
    *
+   * @details
+   * 文件被映射到内存后分块，各块并行地用向量化的同步字查找定位帧起始位置，
+   * 数据完整时按帧长跳跃校验，最后拼接成帧偏移表。默认遇到第一个不连续的帧时停止计数；
+   * 重同步模式下（见set_resync()）跳过损坏的帧继续查找，并按帧序列号补齐缺失的帧。
+   *
    * @note
    * 需要手工调用本函数一次，才能获取正确的传感器类型、图像尺寸，以及使用迭代器。
    *
@@ -92,118 +142,681 @@ class AHSIData : public IRawData<AHSIFrame> {
   /**
    * @brief 返回第 i 帧。
    *
+   * @note 可重入。每次调用返回的帧数据互相独立，可在多个线程中同时解析不同的帧。
+   *
    * @param i 帧计数，从0开始。
    * @return AHSIFrame 包含帧图像数据和帧序列号（后续扣暗电平步骤需要用到）。
    */
   AHSIFrame GetFrame(int i) const override;
 
+  /**
+   * @brief 将第 i 帧解析到调用者提供的缓冲区中，并返回该帧。
+   *
+   * @details
+   * ReadMode::Stream方式下，缓冲区尺寸和类型匹配时直接复用，避免每帧分配内存；
+   * 返回帧的图像数据与缓冲区共享内存，在缓冲区被再次使用前保持有效。
+   * ReadMode::Mapped方式下，只有压缩帧会解码到缓冲区中，其余帧不使用缓冲区。
+   *
+   * @param i 帧计数，从0开始。
+   * @param buffer 帧缓冲区。每个工作线程应使用各自的缓冲区。
+   * @return AHSIFrame
+   */
+  AHSIFrame GetFrame(int i, cv::Mat& buffer) const;
+
+  /**
+   * @brief 一次读取从first开始的连续count帧，解交织为 count * bands * samples
+   * 的三维矩阵。
+   *
+   * @details
+   * ReadMode::Stream方式下，所有帧（含行头）通过一次顺序读取载入；
+   * ReadMode::Mapped方式下，直接从映射区域并行复制。压缩帧由多个线程并行解码。
+   * 帧序列号可通过frame_index()获取。
+   *
+   * @param first 起始帧序号，从0开始计数。
+   * @param count 帧数。
+   * @param out 输出矩阵，像元数据类型为16位无符号整型。
+   */
+  void GetFrames(int first, int count, cv::Mat& out) const override;
+
+  /**
+   * @brief 第 i 帧的帧序列号。
+   *
+   * @param i 帧计数，从0开始。
+   * @return uint32_t
+   */
+  uint32_t frame_index(int i) const { return indices_.at(i); }
+
   SensorType sensor_type() const { return type_; }
 
   Compress compress_mode() const { return compress_; }
 
+  /**
+   * @brief 设置压缩帧解码器。需要在Traverse()之前调用。
+   *
+   * @details
+   * 压缩数据在GetFrame()中逐帧解码，在GetFrames()中多线程并行解码。
+   * 压缩数据未设置解码器时，Traverse()抛出std::runtime_error。
+   *
+   * @param decoder 解码器
+   */
+  void set_decoder(std::shared_ptr<const FrameDecoder> decoder) {
+    decoder_ = std::move(decoder);
+  }
+
+  /**
+   * @brief 是否启用重同步模式。默认不启用。需要在Traverse()之前调用。
+   *
+   * @details
+   * 启用后，Traverse()遇到损坏（截断）的帧时丢弃该帧，从下一个有效的帧起始位置继续，
+   * 直到文件末尾。相邻有效帧的帧序列号不连续时，认为中间的帧缺失，在帧偏移表中记录为缺帧，
+   * 使行数与成像时的帧数一致。缺帧由GetFrame()和GetFrames()以填充值（见set_fill_value()）
+   * 补齐，GetFrame()返回的帧valid标志为false。序列号回退或跳变超过max_gap帧时视为序列号错误，不补帧。
+   *
+   * @param value
+   */
+  void set_resync(bool value) { resync_ = value; }
+
+  /**
+   * @brief 设置缺帧的填充值。默认为0。
+   *
+   * @param value
+   */
+  void set_fill_value(uint16_t value) { fill_value_ = value; }
+
+  /**
+   * @brief 第 i 帧是否为缺帧。
+   *
+   * @param i 帧计数，从0开始。
+   * @return true 缺帧，图像数据为填充值
+   * @return false
+   */
+  bool is_missing(int i) const { return offsets_.at(i) == missing_offset_(); }
+
+  /**
+   * @brief 缺帧总数。
+   *
+   * @return int
+   */
+  int missing_frames() const {
+    return static_cast<int>(std::count_if(
+        offsets_.begin(), offsets_.end(),
+        [](size_t offset) { return offset == missing_offset_(); }));
+  }
+
+  /** @brief 重同步模式下补齐的最大连续缺帧数。 */
+  static constexpr uint32_t max_gap = 4096;
+
+  /**
+   * @brief 是否使用帧索引文件。默认不使用。需要在Traverse()之前调用。
+   *
+   * @details
+   * 使用时，Traverse()优先载入帧索引文件（见index_file()），
+   * 索引文件中记录的数据文件大小和修改时间与当前文件一致、且帧偏移量均不超出文件时，
+   * 直接采用其中的帧偏移表，不再扫描数据；否则扫描数据，并将结果写入索引文件供下次使用。
+   * 索引文件无法写入时不影响遍历结果。
+   *
+   * @param value
+   */
+  void set_use_index(bool value) { use_index_ = value; }
+
+  /**
+   * @brief 设置帧索引文件所在的目录。默认为空，即与0级数据同目录。
+   *
+   * @details 0级数据所在目录只读或不宜写入其他文件时，可将索引文件放在单独的缓存目录中。
+   *
+   * @param dir 目录路径，需已存在
+   */
+  void set_index_dir(std::string dir) { index_dir_ = std::move(dir); }
+
+  /**
+   * @brief 帧索引文件路径，即0级数据文件名加后缀".hspidx"，
+   * 位于set_index_dir()设置的目录，未设置时与0级数据同目录。
+   *
+   * @return std::string
+   */
+  std::string index_file() const {
+    if (index_dir_.empty()) {
+      return filename + ".hspidx";
+    }
+    return (boost::filesystem::path(index_dir_) /
+            (boost::filesystem::path(filename).filename().string() + ".hspidx"))
+        .string();
+  }
+
  private:
+  /** @brief 帧索引文件的文件头。各字段均按本机字节序存储。 */
+  struct IndexHeader {
+    char magic[8];
+    uint64_t file_size;
+    int64_t mtime;
+    int32_t sensor_type;
+    int32_t compress;
+    int32_t samples;
+    int32_t bands;
+    int32_t variable_size;
+    int32_t resync;
+    uint64_t n_frames;
+  };
+
+  /** @brief 帧索引文件的标识和版本，共8字节。 */
+  static const char* index_magic_() { return "HSPIDX02"; }
+  /** @brief 每帧前的引导字节数。 */
+  static constexpr size_t lead_size_ = 8;
+  /** @brief 每个波段的行头字节数。 */
+  static constexpr size_t header_size_ = 12;
+  /** @brief 帧偏移表中表示缺帧的偏移量。 */
+  static size_t missing_offset_() { return static_cast<size_t>(-1); }
+
   SensorType type_ = SensorType::SWIR;
   Compress compress_ = Compress::Lossless;
+  /** @brief 每个波段（含行头）的字节数。 */
+  size_t band_size_ = 0;
+  /** @brief 每帧（含引导字节）的字节数。 */
+  size_t frame_size_ = 0;
+  /** @brief 帧偏移表，即各帧第一个波段行头在文件中的偏移量。 */
+  std::vector<size_t> offsets_;
+  /** @brief 各帧的帧序列号。 */
+  std::vector<uint32_t> indices_;
+  bool use_index_ = false;
+  std::string index_dir_;
+  bool resync_ = false;
+  uint16_t fill_value_ = 0;
+  std::shared_ptr<const FrameDecoder> decoder_;
+
+ private:
+  /** @brief pos处是否为帧引导头。 */
+  bool is_marker_(size_t pos) const;
+
+  /** @brief pos处是否为数据帧行头（引导头、数据帧标志、像元数均匹配）。 */
+  bool is_header_(size_t pos) const;
+
+  /** @brief pos处是否为完整的定长数据帧行头。 */
+  bool is_data_header_(size_t pos) const;
+
+  /** @brief pos处是否为帧的第一个波段行头，而不是帧中间某个波段的行头。 */
+  bool is_frame_start_(size_t pos) const;
+
+  /**
+   * @brief 查找[from, to)中第一个帧起始位置。
+   *
+   * @return size_t 帧起始偏移量，未找到时返回to
+   */
+  size_t next_frame_start_(size_t from, size_t to) const;
+
+  /**
+   * @brief 扫描[from, to)中起始的所有帧，将帧偏移量追加到offsets。
+   *
+   */
+  void scan_(size_t from, size_t to, std::vector<size_t>* offsets) const;
+
+  /**
+   * @brief 扫描[from, to)中起始的所有变长（压缩）帧，将帧偏移量追加到offsets。
+   *
+   */
+  void scan_variable_(size_t from, size_t to,
+                      std::vector<size_t>* offsets) const;
+
+  /** @brief 压缩数据未设置解码器时抛出std::runtime_error。 */
+  void check_decoder_() const {
+    if (compress_ != Compress::Direct && !decoder_) {
+      throw std::runtime_error(
+          "compressed data requires a frame decoder, see set_decoder()");
+    }
+  }
+
+  /** @brief 是否按变长（压缩）帧解析。 */
+  bool variable_size_() const {
+    return decoder_ && compress_ != Compress::Direct;
+  }
+
+  /** @brief 第i帧（非缺帧）在文件中的结束位置（不含）。 */
+  size_t frame_end_(int i) const {
+    if (!variable_size_()) {
+      return offsets_[i] + band_size_ * n_bands_;
+    }
+    for (size_t k = i + 1; k < offsets_.size(); ++k) {
+      if (offsets_[k] != missing_offset_()) {
+        return offsets_[k] - lead_size_;
+      }
+    }
+    return mapped_size();
+  }
+
+  /** @brief 重同步：丢弃与下一帧重叠的截断帧，按帧序列号在帧偏移表中插入缺帧。 */
+  void fill_gaps_();
+
+  /**
+   * @brief 载入帧索引文件。
+   *
+   * @return true 索引文件存在且与数据文件匹配，已更新帧偏移表和图像尺寸
+   * @return false 索引文件不存在、已损坏或已过期
+   */
+  bool load_index_();
+
+  /**
+   * @brief 将帧偏移表写入帧索引文件。写入失败时静默返回。
+   *
+   */
+  void save_index_() const;
 };
 
-void AHSIData::Traverse() {
+inline void AHSIData::Traverse() {
   if (is_traversed_) {
     return;
   }
-  //  parse the first frame
-  const int buffer_size = 5 * 1024;
-  auto buffer = std::make_unique<char[]>(buffer_size);
-  std::ifstream in_stream(filename, std::ios::binary);
-  if (!in_stream) {
-    throw std::runtime_error("unable to open raw data");
+  map_file();
+  if (use_index_ && load_index_()) {
+    check_decoder_();
+    is_traversed_ = true;
+    return;
   }
-  in_stream.read(buffer.get(), buffer_size);
+  const char* data = mapped_data();
+  const size_t file_size = mapped_size();
 
-  auto head = std::search(buffer.get(), buffer.get() + buffer_size,
-                          leading_bytes, leading_bytes + sizeof(leading_bytes));
-  if (head == buffer.get() + buffer_size) {
+  //  parse the first frame
+  const char* head = find_marker(data, data + file_size, leading_bytes);
+  if (head + header_size_ > data + file_size) {
     throw std::runtime_error("unable to find leading bytes!");
   }
-  n_samples_ =
-      boost::endian::load_big_u16(reinterpret_cast<unsigned char*>(head + 4));
+  n_samples_ = boost::endian::load_big_u16(
+      reinterpret_cast<const unsigned char*>(head + 4));
   if ((head[6] & 0x0F) != 0x07) {
     throw std::runtime_error("this frame is not a data frame");
   }
   type_ = static_cast<SensorType>(head[6] >> 4);
   compress_ = static_cast<Compress>(head[7] & 0x03);
 
-  if (compress_ == Compress::Direct) {
-    n_bands_ = type_ == SensorType::SWIR ? 180 : 150;
-  } else {
-    // set n_bands_ to default regardless of compress mode
-    n_bands_ = type_ == SensorType::SWIR ? 180 : 150;
-  }
-
-  // traverse the whole data
-  const size_t band_size = 6 + 6 + n_samples_ * 2;
-  const size_t frame_size = 8 + band_size * n_bands_;
-  const size_t read_size = 100;
-  in_stream.seekg(0, in_stream.beg);
-  while (in_stream.read(buffer.get(), read_size)) {
-    head = std::search(buffer.get(), buffer.get() + buffer_size, leading_bytes,
-                       leading_bytes + sizeof(leading_bytes));
-    if (head != buffer.get() + 8) {
+  check_decoder_();
+  n_bands_ = type_ == SensorType::SWIR ? 180 : 150;
+  band_size_ = header_size_ + n_samples_ * 2;
+  frame_size_ = lead_size_ + band_size_ * n_bands_;
+
+  // traverse the whole data, chunks are scanned in parallel
+  const size_t first = head - data;
+  const size_t n_threads = std::max(cv::getNumThreads(), 1);
+  const size_t chunk_size = std::max(
+      16 * frame_size_, (file_size - first) / (4 * n_threads) + 1);
+  const int n_chunks =
+      static_cast<int>((file_size - first + chunk_size - 1) / chunk_size);
+  std::vector<std::vector<size_t>> chunk_offsets(n_chunks);
+  const bool variable_size = variable_size_();
+  cv::parallel_for_(cv::Range(0, n_chunks), [&](const cv::Range& range) {
+    for (int k = range.start; k < range.end; ++k) {
+      const size_t chunk_begin = first + k * chunk_size;
+      const size_t chunk_end = std::min(chunk_begin + chunk_size, file_size);
+      if (variable_size) {
+        scan_variable_(chunk_begin, chunk_end, &chunk_offsets[k]);
+      } else {
+        scan_(chunk_begin, chunk_end, &chunk_offsets[k]);
+      }
+    }
+  });
+
+  // stitch the chunks, stop at the first broken frame
+  offsets_.clear();
+  for (auto&& each : chunk_offsets) {
+    if (variable_size || resync_) {
+      offsets_.insert(offsets_.end(), each.begin(), each.end());
+      continue;
+    }
+    auto it = each.begin();
+    while (it != each.end() &&
+           (offsets_.empty() || *it == offsets_.back() + frame_size_)) {
+      offsets_.push_back(*it++);
+    }
+    if (it != each.end()) {
       break;
     }
-    ++n_lines_;
-    in_stream.seekg(-read_size + frame_size, in_stream.cur);
   }
-  // reserve space
-  img_ = cv::Mat::zeros(cv::Size(n_samples_, n_bands_),
-                        cv::DataType<uint16_t>::type);
+  n_lines_ = static_cast<int>(offsets_.size());
+  indices_.resize(offsets_.size());
+  std::transform(offsets_.begin(), offsets_.end(), indices_.begin(),
+                 [data](size_t offset) {
+                   return boost::endian::load_big_u24(
+                       reinterpret_cast<const uint8_t*>(data + offset + 9));
+                 });
+  if (resync_) {
+    fill_gaps_();
+  }
+  if (use_index_) {
+    save_index_();
+  }
   is_traversed_ = true;
 }
 
-AHSIFrame AHSIData::GetFrame(int i) const {
+inline bool AHSIData::is_marker_(size_t pos) const {
+  return pos + sizeof(leading_bytes) <= mapped_size() &&
+         std::equal(leading_bytes, leading_bytes + sizeof(leading_bytes),
+                    mapped_data() + pos);
+}
+
+inline bool AHSIData::is_header_(size_t pos) const {
+  if (!is_marker_(pos) || pos + header_size_ > mapped_size()) {
+    return false;
+  }
+  const char* head = mapped_data() + pos;
+  return (head[6] & 0x0F) == 0x07 &&
+         boost::endian::load_big_u16(reinterpret_cast<const unsigned char*>(
+             head + 4)) == n_samples_;
+}
+
+inline bool AHSIData::is_data_header_(size_t pos) const {
+  return pos + band_size_ * n_bands_ <= mapped_size() && is_header_(pos);
+}
+
+inline bool AHSIData::is_frame_start_(size_t pos) const {
+  // a sync marker one band before (or one frame minus one band after) means
+  // pos is the header of a band in the middle of a frame
+  return is_data_header_(pos) &&
+         !(pos >= band_size_ && is_marker_(pos - band_size_)) &&
+         !is_marker_(pos + frame_size_ - band_size_);
+}
+
+inline size_t AHSIData::next_frame_start_(size_t from, size_t to) const {
+  const char* data = mapped_data();
+  const char* last =
+      data + std::min(to + sizeof(leading_bytes) - 1, mapped_size());
+  for (const char* p = find_marker(data + from, last, leading_bytes);
+       p != last; p = find_marker(p + 1, last, leading_bytes)) {
+    if (p - data >= static_cast<std::ptrdiff_t>(to)) {
+      break;
+    }
+    if (is_frame_start_(p - data)) {
+      return p - data;
+    }
+  }
+  return to;
+}
+
+inline void AHSIData::scan_(size_t from, size_t to,
+                            std::vector<size_t>* offsets) const {
+  size_t pos = next_frame_start_(from, to);
+  while (pos < to) {
+    offsets->push_back(pos);
+    const size_t next = pos + frame_size_;
+    // jump a whole frame ahead while the data is intact, search otherwise
+    pos = (next >= to || is_frame_start_(next))
+              ? next
+              : next_frame_start_(pos + 1, to);
+  }
+}
+
+inline void AHSIData::scan_variable_(size_t from, size_t to,
+                                     std::vector<size_t>* offsets) const {
+  const char* data = mapped_data();
+  const char* last =
+      data + std::min(to + sizeof(leading_bytes) - 1, mapped_size());
+  for (const char* p = find_marker(data + from, last, leading_bytes);
+       p != last && p - data < static_cast<std::ptrdiff_t>(to);
+       p = find_marker(p + 1, last, leading_bytes)) {
+    if (is_header_(p - data)) {
+      offsets->push_back(p - data);
+    }
+  }
+}
+
+inline void AHSIData::fill_gaps_() {
+  std::vector<size_t> offsets;
+  std::vector<uint32_t> indices;
+  offsets.reserve(offsets_.size());
+  indices.reserve(indices_.size());
+  for (size_t k = 0; k < offsets_.size(); ++k) {
+    // a fixed-size frame overlapping the next one is truncated
+    if (!variable_size_() && k + 1 < offsets_.size() &&
+        offsets_[k + 1] - offsets_[k] < frame_size_) {
+      continue;
+    }
+    if (!indices.empty()) {
+      // frame indices are 24-bit counters
+      const uint32_t delta = (indices_[k] - indices.back()) & 0xFFFFFF;
+      if (delta > 1 && delta <= max_gap) {
+        for (uint32_t j = 1; j < delta; ++j) {
+          offsets.push_back(missing_offset_());
+          indices.push_back((indices.back() + 1) & 0xFFFFFF);
+        }
+      }
+    }
+    offsets.push_back(offsets_[k]);
+    indices.push_back(indices_[k]);
+  }
+  offsets_ = std::move(offsets);
+  indices_ = std::move(indices);
+  n_lines_ = static_cast<int>(offsets_.size());
+}
+
+inline AHSIFrame AHSIData::GetFrame(int i) const {
+  cv::Mat buffer;
+  return GetFrame(i, buffer);
+}
+
+inline AHSIFrame AHSIData::GetFrame(int i, cv::Mat& buffer) const {
   if (!is_traversed_) {
     throw std::runtime_error("Data is not traversed");
   }
-  if (i >= n_lines_) {
+  if (i < 0 || i >= n_lines_) {
     throw std::out_of_range("");
   }
+  if (offsets_[i] == missing_offset_()) {
+    buffer.create(n_bands_, n_samples_, cv::DataType<uint16_t>::type);
+    buffer.setTo(fill_value_);
+    return AHSIFrame(buffer, indices_[i], false);
+  }
+  if (variable_size_()) {
+    const size_t size = frame_end_(i) - offsets_[i];
+    std::unique_ptr<char[]> compressed;
+    const char* src = mapped_data() + offsets_[i];
+    if (read_mode() == ReadMode::Stream) {
+      std::ifstream in_stream(filename, std::ios::binary);
+      compressed = std::make_unique<char[]>(size);
+      in_stream.seekg(offsets_[i], in_stream.beg);
+      if (!in_stream.read(compressed.get(), size)) {
+        throw std::runtime_error("unable to read raw data");
+      }
+      src = compressed.get();
+    }
+    buffer.create(n_bands_, n_samples_, cv::DataType<uint16_t>::type);
+    (*decoder_)(src + header_size_, size - header_size_, compress_, buffer);
+    return AHSIFrame(buffer, indices_[i]);
+  }
+  // each band is a row, rows are band_size_ bytes apart; the frame is the
+  // sub-matrix without the band headers
+  const int step = static_cast<int>(band_size_ / sizeof(uint16_t));
+  const cv::Range samples(header_size_ / sizeof(uint16_t),
+                          header_size_ / sizeof(uint16_t) + n_samples_);
+  if (read_mode() == ReadMode::Mapped) {
+    // zero-copy
+    cv::Mat frame(n_bands_, step, cv::DataType<uint16_t>::type,
+                  mapped_data() + offsets_[i]);
+    return AHSIFrame(frame.colRange(samples), indices_[i]);
+  }
   std::ifstream in_stream(filename, std::ios::binary);
   if (!in_stream) {
     throw std::runtime_error("unable to open raw data");
   }
+  // read the whole frame, band headers included, in one go
+  buffer.create(n_bands_, step, cv::DataType<uint16_t>::type);
+  in_stream.seekg(offsets_[i], in_stream.beg);
+  in_stream.read(reinterpret_cast<char*>(buffer.data), band_size_ * n_bands_);
+  if (!in_stream) {
+    throw std::runtime_error("unable to read raw data");
+  }
+  return AHSIFrame(buffer.colRange(samples), indices_[i]);
+}
+
+inline void AHSIData::GetFrames(int first, int count, cv::Mat& out) const {
+  if (!is_traversed_) {
+    throw std::runtime_error("Data is not traversed");
+  }
+  if (first < 0 || count < 0 || first + count > n_lines_) {
+    throw std::out_of_range("");
+  }
+  const int sizes[] = {count, n_bands_, n_samples_};
+  out.create(3, sizes, cv::DataType<uint16_t>::type);
+  if (count == 0) {
+    return;
+  }
+  const size_t line_size = n_samples_ * sizeof(uint16_t);
+  // read from the first to the last present frame
+  int front = first, back = first + count - 1;
+  while (front <= back && offsets_[front] == missing_offset_()) ++front;
+  while (back >= front && offsets_[back] == missing_offset_()) --back;
+  if (front > back) {
+    out.setTo(fill_value_);
+    return;
+  }
+  const size_t begin = offsets_[front];
+  const size_t end = frame_end_(back);
+
+  std::unique_ptr<char[]> buffer;
+  const char* src = mapped_data() + begin;
+  if (read_mode() == ReadMode::Stream) {
+    std::ifstream in_stream(filename, std::ios::binary);
+    if (!in_stream) {
+      throw std::runtime_error("unable to open raw data");
+    }
+    buffer = std::make_unique<char[]>(end - begin);
+    in_stream.seekg(begin, in_stream.beg);
+    in_stream.read(buffer.get(), end - begin);
+    if (!in_stream) {
+      throw std::runtime_error("unable to read raw data");
+    }
+    src = buffer.get();
+  }
+  // decode compressed frames or de-interleave (drop the band headers)
+  const bool variable_size = variable_size_();
+  cv::parallel_for_(cv::Range(0, count), [&](const cv::Range& range) {
+    for (int k = range.start; k < range.end; ++k) {
+      if (offsets_[first + k] == missing_offset_()) {
+        cv::Mat(n_bands_, n_samples_, out.type(), out.ptr(k))
+            .setTo(fill_value_);
+        continue;
+      }
+      const char* band = src + (offsets_[first + k] - begin) + header_size_;
+      if (variable_size) {
+        cv::Mat frame(n_bands_, n_samples_, out.type(), out.ptr(k));
+        const size_t size =
+            frame_end_(first + k) - offsets_[first + k] - header_size_;
+        (*decoder_)(band, size, compress_, frame);
+        continue;
+      }
+      uchar* dst = out.ptr(k);
+      for (int b = 0; b < n_bands_; ++b) {
+        std::copy(band, band + line_size, dst);
+        band += band_size_;
+        dst += line_size;
+      }
+    }
+  });
+}
+
+inline bool AHSIData::load_index_() {
+  boost::system::error_code ec;
+  const auto file_size = boost::filesystem::file_size(filename, ec);
+  if (ec) {
+    return false;
+  }
+  const auto mtime = boost::filesystem::last_write_time(filename, ec);
+  if (ec) {
+    return false;
+  }
+  std::ifstream in_stream(index_file(), std::ios::binary);
+  IndexHeader header;
+  if (!in_stream.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+      !std::equal(header.magic, header.magic + sizeof(header.magic),
+                  index_magic_()) ||
+      header.file_size != file_size || header.mtime != mtime ||
+      header.samples <= 0 || header.bands <= 0 ||
+      header.n_frames > file_size / header_size_) {
+    return false;
+  }
+  const bool variable_size =
+      decoder_ && static_cast<Compress>(header.compress) != Compress::Direct;
+  if (header.variable_size != static_cast<int32_t>(variable_size) ||
+      header.resync != static_cast<int32_t>(resync_)) {
+    return false;
+  }
+  std::vector<uint64_t> offsets(header.n_frames);
+  std::vector<uint32_t> indices(header.n_frames);
+  if (!in_stream.read(reinterpret_cast<char*>(offsets.data()),
+                      offsets.size() * sizeof(uint64_t)) ||
+      !in_stream.read(reinterpret_cast<char*>(indices.data()),
+                      indices.size() * sizeof(uint32_t))) {
+    return false;
+  }
+  // a stale or corrupted index must never point GetFrame() outside the file
+  const size_t band_size =
+      header_size_ + static_cast<size_t>(header.samples) * 2;
+  const size_t min_frame_size =
+      variable_size ? header_size_ : band_size * header.bands;
+  size_t next = 0;
+  for (auto offset : offsets) {
+    if (offset == missing_offset_()) {
+      continue;
+    }
+    if (offset < next || offset > file_size ||
+        file_size - offset < min_frame_size) {
+      return false;
+    }
+    next = offset + min_frame_size;
+  }
+  type_ = static_cast<SensorType>(header.sensor_type);
+  compress_ = static_cast<Compress>(header.compress);
+  n_samples_ = header.samples;
+  n_bands_ = header.bands;
+  n_lines_ = static_cast<int>(header.n_frames);
+  band_size_ = header_size_ + n_samples_ * 2;
+  frame_size_ = lead_size_ + band_size_ * n_bands_;
+  offsets_.assign(offsets.begin(), offsets.end());
+  indices_ = std::move(indices);
+  return true;
+}
+
+inline void AHSIData::save_index_() const {
+  boost::system::error_code ec;
+  IndexHeader header;
+  std::copy(index_magic_(), index_magic_() + sizeof(header.magic),
+            header.magic);
+  header.file_size = boost::filesystem::file_size(filename, ec);
+  if (ec) {
+    return;
+  }
+  header.mtime = boost::filesystem::last_write_time(filename, ec);
+  if (ec) {
+    return;
+  }
+  header.sensor_type = static_cast<int32_t>(type_);
+  header.compress = static_cast<int32_t>(compress_);
+  header.samples = n_samples_;
+  header.bands = n_bands_;
+  header.variable_size = variable_size_();
+  header.resync = resync_;
+  header.n_frames = offsets_.size();
+  std::vector<uint64_t> offsets(offsets_.begin(), offsets_.end());
 
-  // size in bytes
-  const size_t header_size = 12;
-  const size_t band_size = n_samples_ * 2 + header_size;
-  const size_t frame_size = band_size * n_bands_;
-
-  auto buffer = std::make_unique<char[]>(frame_size);
-  in_stream.seekg(8 + i * (frame_size + 8), in_stream.beg);
-  in_stream.read(buffer.get(), frame_size);
-  uint32_t index =
-      boost::endian::load_big_u24(reinterpret_cast<uint8_t*>(buffer.get() + 9));
-  // Method 1
-  // std::vector<uint16_t> res_vec(n_samples_ * n_bands_);
-  // auto res_it = res_vec.begin();
-  // for (size_t k = 0; k < frame_size; k += 2) {
-  //   if ((k % band_size) >= header_size) {
-  //     *res_it =
-  //     boost::endian::load_little_u16(reinterpret_cast<uint8_t*>(buffer.get()
-  //     + k));
-  //     ++res_it;
-  //   }
-  // }
-  // memcpy(img_.data, res_vec.data(), res_vec.size() * sizeof(uint16_t));
-
-  // Method 2, 10x faster than method 1
-  size_t buffer_offset = header_size;
-  size_t img_offset = 0;
-  for (auto b = 0; b < n_bands_; ++b) {
-    memcpy(img_.data + img_offset, buffer.get() + buffer_offset,
-           n_samples_ * 2);
-    buffer_offset += band_size;
-    img_offset += n_samples_ * 2;
-  }
-  return AHSIFrame(img_, index);
+  // write to a temporary file first, so that concurrent jobs never see a
+  // partially written index
+  const auto tmp_file = boost::filesystem::unique_path(
+      index_file() + ".%%%%-%%%%", ec);
+  if (ec) {
+    return;
+  }
+  {
+    std::ofstream out_stream(tmp_file.string(), std::ios::binary);
+    out_stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out_stream.write(reinterpret_cast<const char*>(offsets.data()),
+                     offsets.size() * sizeof(uint64_t));
+    out_stream.write(reinterpret_cast<const char*>(indices_.data()),
+                     indices_.size() * sizeof(uint32_t));
+    if (!out_stream) {
+      out_stream.close();
+      boost::filesystem::remove(tmp_file, ec);
+      return;
+    }
+  }
+  boost::filesystem::rename(tmp_file, index_file(), ec);
+  if (ec) {
+    boost::filesystem::remove(tmp_file, ec);
+  }
 }
 
 }  // namespace hsp
@@ -0,0 +1,137 @@
+/**
+ * @file FramePrefetcher.hpp
+ * @author xiaoyc
+ * @brief 原始数据的后台预读取。
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef HSP_DECODER_FRAMEPREFETCHER_HPP_
+#define HSP_DECODER_FRAMEPREFETCHER_HPP_
+
+// C++ Standard
+#include <iterator>
+
+// Boost
+#include <boost/optional.hpp>
+
+// hsp
+#include "../concurrency.hpp"
+#include "./IRawData.hpp"
+
+namespace hsp {
+
+/**
+ * @brief 帧预读取器。
+ *
+ * @tparam Tf 帧类型，与IRawData的帧类型一致
+ *
+ * @details
+ * 基于hsp::Prefetcher：后台线程按顺序调用IRawData::GetFrame()解析帧，
+ * 放入容量为depth的无锁环形队列；处理线程通过迭代器依次取出已经解析好的帧，
+ * 使磁盘读取与计算重叠进行。
+ *
+ * @par Sample
+ * @code{.cpp}
+ *  hsp::AHSIData L0_data(filename);
+ *  L0_data.Traverse();
+ *  hsp::FramePrefetcher<hsp::AHSIFrame> frames(&L0_data, 16);
+ *  for (auto&& frame : frames) {
+ *    *output_it++ = dpc(dbc(frame));
+ *  }
+ * @endcode
+ *
+ * @note
+ * 只能单次遍历。解析过程中抛出的异常会在处理线程取到对应位置时重新抛出。
+ */
+template <typename Tf>
+class FramePrefetcher {
+ public:
+  /**
+   * @brief 构造函数。构造后立即开始预读取。
+   *
+   * @param raw_data 已经遍历（Traverse）过的原始数据
+   * @param depth 预读取的帧数
+   * @param first 起始帧序号
+   * @param last 结束帧序号（不含），小于0时为原始数据的帧数
+   */
+  explicit FramePrefetcher(const IRawData<Tf>* raw_data, int depth = 8,
+                           int first = 0, int last = -1)
+      : last_{last < 0 ? raw_data->lines() : last},
+        cur_{first},
+        prefetcher_(first, last_, depth,
+                    [raw_data](int i) { return raw_data->GetFrame(i); }) {}
+
+  FramePrefetcher(const FramePrefetcher&) = delete;
+  FramePrefetcher& operator=(const FramePrefetcher&) = delete;
+
+  /**
+   * @brief 预读取帧迭代器。对迭代器解引用后，得到 Tf 类型的一帧影像。
+   *
+   */
+  class Iterator : public std::iterator<std::input_iterator_tag, Tf> {
+   public:
+    Iterator(FramePrefetcher* prefetcher, int cur)
+        : prefetcher_{prefetcher}, cur_{cur} {}
+
+    Iterator& operator++() {
+      prefetcher_->advance_();
+      ++cur_;
+      return *this;
+    }
+
+    bool operator==(const Iterator& other) const { return cur_ == other.cur_; }
+
+    bool operator!=(const Iterator& other) const { return !(*this == other); }
+
+    const Tf& operator*() const { return prefetcher_->current_(); }
+
+   private:
+    FramePrefetcher* prefetcher_;
+    int cur_;
+  };
+
+  /**
+   * @brief 返回指向起始位置的迭代器。只能调用一次。
+   *
+   * @return Iterator
+   */
+  Iterator begin() { return Iterator(this, cur_); }
+
+  /**
+   * @brief 返回指向末尾的迭代器。
+   *
+   * @return Iterator
+   */
+  Iterator end() { return Iterator(this, last_); }
+
+ private:
+  const int last_;
+  int cur_;
+  /** @brief 当前帧。为空时表示尚未从队列中取出。 */
+  boost::optional<Tf> current_frame_;
+  Prefetcher<Tf> prefetcher_;
+
+ private:
+  const Tf& current_() {
+    if (!current_frame_) {
+      current_frame_ = prefetcher_.pop();
+    }
+    return *current_frame_;
+  }
+
+  void advance_() {
+    if (!current_frame_) {
+      // the frame was skipped without being dereferenced
+      current_();
+    }
+    current_frame_ = boost::none;
+    ++cur_;
+  }
+};
+
+}  // namespace hsp
+
+#endif  // HSP_DECODER_FRAMEPREFETCHER_HPP_
@@ -12,25 +12,170 @@
 #define HSP_DECODER_HGYDATA_HPP_
 
 // C++ Standard
+#include <algorithm>
 #include <fstream>
+#include <stdexcept>
 #include <string>
 
+// Boost
+#include <boost/filesystem.hpp>
+
 // hsp
+#include "../envi.hpp"
 #include "./IRawData.hpp"
 
 namespace hsp {
 /**
  * @brief 用于解析核工业岩心扫描仪短波相机落盘原始数据。
  *
+ * @details
+ * 落盘数据为16位无符号整型（小端）、按行交织（BIL）的帧序列，每帧为 bands * samples
+ * 的连续数据，帧之间没有间隔；影像尺寸由同名ENVI头文件给出。
+ * 行数以头文件为准，但不超过数据文件实际包含的完整帧数。
  */
 class HGYData : public IRawData<cv::Mat> {
  public:
-  explicit HGYData(const std::string& datafile) : IRawData(datafile) {}
+  /**
+   * @brief 构造函数。
+   *
+   * @param datafile 原始数据路径。
+   * @param mode 读取方式，默认逐帧通过文件流读取。
+   */
+  explicit HGYData(const std::string& datafile,
+                   ReadMode mode = ReadMode::Stream)
+      : IRawData(datafile, mode) {}
+
   void Traverse() override;
+
   cv::Mat GetFrame(int i) const override;
+
+  /**
+   * @brief 读取第i帧，ReadMode::Stream方式下使用调用者提供的缓冲区。
+   *
+   * @details
+   * 缓冲区尺寸和类型匹配时直接复用，避免每帧分配内存；返回帧与缓冲区共享内存。
+   * ReadMode::Mapped方式下返回映射区域上的视图，不使用缓冲区。
+   *
+   * @param i 帧序号，从0开始计数
+   * @param buffer 帧缓冲区
+   * @return cv::Mat
+   */
+  cv::Mat GetFrame(int i, cv::Mat& buffer) const;
+
+  void GetFrames(int first, int count, cv::Mat& out) const override;
+
+ private:
+  /** @brief 第i帧在数据文件中的偏移量。 */
+  std::size_t frame_offset_(int i) const {
+    return header_offset_ + frame_size_ * static_cast<std::size_t>(i);
+  }
+
+ private:
+  std::size_t header_offset_ = 0;
+  std::size_t frame_size_ = 0;
 };
 
-void HGYData::Traverse() {}
+inline void HGYData::Traverse() {
+  if (is_traversed_) {
+    return;
+  }
+  const std::string hdrfile = find_envi_header(filename);
+  if (hdrfile.empty()) {
+    throw std::runtime_error("unable to find ENVI header of " + filename);
+  }
+  const EnviHeader header = read_envi_header(hdrfile);
+  if (header.data_type != 12 || header.interleave != "bil" ||
+      header.byte_order != 0) {
+    throw std::runtime_error("unsupported raw data layout");
+  }
+
+  std::size_t file_size = 0;
+  if (read_mode() == ReadMode::Mapped) {
+    map_file();
+    file_size = mapped_size();
+  } else {
+    boost::system::error_code ec;
+    file_size = boost::filesystem::file_size(filename, ec);
+    if (ec) {
+      throw std::runtime_error("unable to open raw data");
+    }
+  }
+
+  n_samples_ = header.samples;
+  n_bands_ = header.bands;
+  header_offset_ = header.header_offset;
+  frame_size_ = sizeof(uint16_t) * n_samples_ * n_bands_;
+  const std::size_t n_frames =
+      file_size > header_offset_ ? (file_size - header_offset_) / frame_size_
+                                 : 0;
+  n_lines_ = header.lines > 0
+                 ? static_cast<int>(std::min<std::size_t>(header.lines,
+                                                          n_frames))
+                 : static_cast<int>(n_frames);
+  is_traversed_ = true;
+}
+
+inline cv::Mat HGYData::GetFrame(int i) const {
+  cv::Mat buffer;
+  return GetFrame(i, buffer);
+}
+
+inline cv::Mat HGYData::GetFrame(int i, cv::Mat& buffer) const {
+  if (!is_traversed_) {
+    throw std::runtime_error("Data is not traversed");
+  }
+  if (i < 0 || i >= n_lines_) {
+    throw std::out_of_range("");
+  }
+  if (read_mode() == ReadMode::Mapped) {
+    // zero-copy
+    return cv::Mat(n_bands_, n_samples_, cv::DataType<uint16_t>::type,
+                   mapped_data() + frame_offset_(i));
+  }
+  std::ifstream in_stream(filename, std::ios::binary);
+  if (!in_stream) {
+    throw std::runtime_error("unable to open raw data");
+  }
+  buffer.create(n_bands_, n_samples_, cv::DataType<uint16_t>::type);
+  in_stream.seekg(frame_offset_(i), in_stream.beg);
+  in_stream.read(reinterpret_cast<char*>(buffer.data), frame_size_);
+  if (!in_stream) {
+    throw std::runtime_error("unable to read raw data");
+  }
+  return buffer;
+}
+
+inline void HGYData::GetFrames(int first, int count, cv::Mat& out) const {
+  if (!is_traversed_) {
+    throw std::runtime_error("Data is not traversed");
+  }
+  if (first < 0 || count < 0 || first + count > n_lines_) {
+    throw std::out_of_range("");
+  }
+  const int sizes[] = {count, n_bands_, n_samples_};
+  out.create(3, sizes, cv::DataType<uint16_t>::type);
+  if (count == 0) {
+    return;
+  }
+  // frames are stored back to back, the cube is a single contiguous block
+  if (read_mode() == ReadMode::Mapped) {
+    const char* src = mapped_data() + frame_offset_(first);
+    cv::parallel_for_(cv::Range(0, count), [&](const cv::Range& range) {
+      std::copy(src + frame_size_ * range.start, src + frame_size_ * range.end,
+                out.ptr(range.start));
+    });
+    return;
+  }
+  std::ifstream in_stream(filename, std::ios::binary);
+  if (!in_stream) {
+    throw std::runtime_error("unable to open raw data");
+  }
+  in_stream.seekg(frame_offset_(first), in_stream.beg);
+  in_stream.read(reinterpret_cast<char*>(out.data), frame_size_ * count);
+  if (!in_stream) {
+    throw std::runtime_error("unable to read raw data");
+  }
+}
 
 }  // namespace hsp
 
@@ -13,13 +13,27 @@
 
 // C++ Standard
 #include <iterator>
+#include <stdexcept>
 #include <string>
 
+// Boost
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
 // OpenCV
 #include <opencv2/core.hpp>
 
 namespace hsp {
 
+/**
+ * @brief 原始数据的读取方式。
+ *
+ */
+enum class ReadMode {
+  Stream, /**< 每次取帧时通过文件流读取，帧数据复制到内存缓冲区 */
+  Mapped  /**< 整个文件只映射一次，帧数据是映射区域上的视图，无系统调用和复制 */
+};
+
 /**
  * @brief
  * 原始数据解析基类，实现了帧的输出迭代器和一些基本查询接口。
@@ -39,8 +53,11 @@ class IRawData {
    * @brief 构造函数。
    *
    * @param datafile 原始数据路径。
+   * @param mode 读取方式，默认逐帧通过文件流读取。
    */
-  explicit IRawData(const std::string& datafile) : filename{datafile} {}
+  explicit IRawData(const std::string& datafile,
+                    ReadMode mode = ReadMode::Stream)
+      : filename{datafile}, mode_{mode} {}
 
   IRawData(const IRawData&) = delete;
 
@@ -54,11 +71,28 @@ class IRawData {
   /**
    * @brief 纯虚函数。返回第i帧的帧对象。
    *
+   * @note
+   * 实现应当是可重入的：返回的帧不能与其他调用返回的帧共享可写的缓冲区，以便多个线程同时取帧。
+   *
    * @param i 原始数据的帧序号，从0开始计数。
    * @return Tf 帧类型，默认是cv::Mat，可自定义以携带其他帧信息。
    */
   virtual Tf GetFrame(int i) const = 0;
 
+  /**
+   * @brief 纯虚函数。一次读取从first开始的连续count帧。
+   *
+   * @details
+   * 实现者应尽量以一次大块顺序读取获得全部帧，并解交织为一个
+   * count * bands * samples 的三维矩阵，第k帧的图像为
+   * cv::Mat(bands(), samples(), out.type(), out.ptr(k))。
+   *
+   * @param first 起始帧序号，从0开始计数。
+   * @param count 帧数。
+   * @param out 输出矩阵，尺寸或类型不符时重新分配。
+   */
+  virtual void GetFrames(int first, int count, cv::Mat& out) const = 0;
+
   /**
    * @brief 原始数据每个波段的像元数。
    *
@@ -80,6 +114,13 @@ class IRawData {
    */
   int bands() const { return n_bands_; }
 
+  /**
+   * @brief 原始数据的读取方式。
+   *
+   * @return ReadMode
+   */
+  ReadMode read_mode() const { return mode_; }
+
   /**
    * @brief 帧迭代器。对迭代器解引用后，得到 Tf 类型的一帧影像。
    *
@@ -182,6 +223,43 @@ class IRawData {
    */
   FrameIterator end() const { return FrameIterator(this, n_lines_); }
 
+ protected:
+  /**
+   * @brief 将原始数据文件整体映射到内存。重复调用不会重新映射。
+   *
+   * @note
+   * 映射区域为写时复制（copy-on-write）模式：对帧视图的原地修改只在本进程内可见，不会写回文件。
+   */
+  void map_file() {
+    if (region_.get_address() != nullptr) {
+      return;
+    }
+    namespace bip = boost::interprocess;
+    try {
+      mapping_ = bip::file_mapping(filename.c_str(), bip::read_only);
+      region_ = bip::mapped_region(mapping_, bip::copy_on_write);
+    } catch (const bip::interprocess_exception&) {
+      throw std::runtime_error("unable to map raw data");
+    }
+    region_.advise(bip::mapped_region::advice_sequential);
+  }
+
+  /**
+   * @brief 映射区域的起始地址。未映射时返回nullptr。
+   *
+   * @return char*
+   */
+  char* mapped_data() const {
+    return static_cast<char*>(region_.get_address());
+  }
+
+  /**
+   * @brief 映射区域的字节数，即原始数据文件的大小。
+   *
+   * @return std::size_t
+   */
+  std::size_t mapped_size() const { return region_.get_size(); }
+
  protected:
   /** @brief 如果已经运行Traverse()函数，值应设为true，否则为false。 */
   bool is_traversed_ = false;
@@ -191,8 +269,11 @@ class IRawData {
   int n_bands_ = 0;
   /** @brief 原始数据包含的影像行数。应在Traverse()函数中设置。 */
   int n_lines_ = 0;
-  /** @brief 用于存储单帧影像数据。 */
-  cv::Mat img_;
+
+ private:
+  ReadMode mode_;
+  boost::interprocess::file_mapping mapping_;
+  boost::interprocess::mapped_region region_;
 };
 
 }  // namespace hsp
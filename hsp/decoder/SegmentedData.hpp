@@ -0,0 +1,193 @@
+/**
+ * @file SegmentedData.hpp
+ * @author xiaoyc
+ * @brief 将分段落盘的原始数据拼接为一条连续的条带。
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef HSP_DECODER_SEGMENTEDDATA_HPP_
+#define HSP_DECODER_SEGMENTEDDATA_HPP_
+
+// C++ Standard
+#include <algorithm>
+#include <exception>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+// hsp
+#include "./IRawData.hpp"
+
+namespace hsp {
+
+/**
+ * @brief 分段原始数据。
+ *
+ * @tparam TRaw 每个分段的原始数据类型，如AHSIData、HGYData
+ * @tparam Tf 帧类型，默认与TRaw的帧类型一致
+ *
+ * @details
+ * 把按时间顺序排列的多个分段文件视为一条连续的条带：帧序号在各分段间连续编号，
+ * 第一个分段的帧为0 ~ n0-1，第二个分段的帧紧随其后，依此类推。各分段的Traverse()并行执行，
+ * 取帧时转交给帧所在的分段，因此单次遍历即可输出整条条带，无需中间文件和拼接。
+ *
+ * @par Sample
+ * @code{.cpp}
+ *  hsp::SegmentedData<hsp::AHSIData> L0_data({seg1, seg2, seg3});
+ *  L0_data.Traverse();
+ *  hsp::FramePrefetcher<hsp::AHSIFrame> frames(&L0_data, 16);
+ *  for (auto&& frame : frames) {
+ *    *output_it++ = dbc(frame);
+ *  }
+ * @endcode
+ *
+ * @note 各分段的像元数和波段数必须一致。
+ */
+template <typename TRaw, typename Tf = decltype(std::declval<const TRaw&>()
+                                                     .GetFrame(0))>
+class SegmentedData : public IRawData<Tf> {
+ public:
+  /**
+   * @brief 构造函数。
+   *
+   * @param datafiles 按时间顺序排列的分段文件路径，至少一个
+   * @param mode 各分段的读取方式
+   */
+  explicit SegmentedData(const std::vector<std::string>& datafiles,
+                         ReadMode mode = ReadMode::Stream)
+      : IRawData<Tf>(first_file_(datafiles), mode) {
+    for (auto&& each : datafiles) {
+      segments_.push_back(std::make_unique<TRaw>(each, mode));
+    }
+  }
+
+  /**
+   * @brief 并行遍历全部分段，建立连续的帧编号。
+   *
+   */
+  void Traverse() override;
+
+  Tf GetFrame(int i) const override {
+    const auto loc = locate_(i);
+    return segments_[loc.first]->GetFrame(loc.second);
+  }
+
+  void GetFrames(int first, int count, cv::Mat& out) const override;
+
+  /**
+   * @brief 分段数。
+   *
+   * @return int
+   */
+  int n_segments() const { return static_cast<int>(segments_.size()); }
+
+  /**
+   * @brief 第k个分段。可在Traverse()之前用来设置各分段的解析选项。
+   *
+   * @param k 分段序号，从0开始计数
+   * @return TRaw&
+   */
+  TRaw& segment(int k) { return *segments_.at(k); }
+
+  /** @copydoc segment(int) */
+  const TRaw& segment(int k) const { return *segments_.at(k); }
+
+  /**
+   * @brief 第k个分段的第一帧在整条条带中的帧序号。
+   *
+   * @param k 分段序号，从0开始计数
+   * @return int
+   */
+  int segment_start(int k) const { return starts_.at(k); }
+
+ private:
+  static const std::string& first_file_(
+      const std::vector<std::string>& datafiles) {
+    if (datafiles.empty()) {
+      throw std::invalid_argument("no segment is given");
+    }
+    return datafiles.front();
+  }
+
+  /** @brief 条带帧序号i对应的（分段序号，分段内帧序号）。 */
+  std::pair<int, int> locate_(int i) const {
+    if (!this->is_traversed_) {
+      throw std::runtime_error("Data is not traversed");
+    }
+    if (i < 0 || i >= this->n_lines_) {
+      throw std::out_of_range("");
+    }
+    const int k = static_cast<int>(
+        std::upper_bound(starts_.begin(), starts_.end(), i) - starts_.begin() -
+        1);
+    return {k, i - starts_[k]};
+  }
+
+ private:
+  std::vector<std::unique_ptr<TRaw>> segments_;
+  /** @brief 各分段第一帧的条带帧序号，末尾附加总帧数。 */
+  std::vector<int> starts_;
+};
+
+template <typename TRaw, typename Tf>
+void SegmentedData<TRaw, Tf>::Traverse() {
+  if (this->is_traversed_) {
+    return;
+  }
+  std::vector<std::exception_ptr> errors(segments_.size());
+  cv::parallel_for_(cv::Range(0, n_segments()), [&](const cv::Range& range) {
+    for (int k = range.start; k < range.end; ++k) {
+      try {
+        segments_[k]->Traverse();
+      } catch (...) {
+        errors[k] = std::current_exception();
+      }
+    }
+  });
+  for (auto&& error : errors) {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+
+  this->n_samples_ = segments_.front()->samples();
+  this->n_bands_ = segments_.front()->bands();
+  starts_.assign(1, 0);
+  for (auto&& segment : segments_) {
+    if (segment->samples() != this->n_samples_ ||
+        segment->bands() != this->n_bands_) {
+      throw std::runtime_error("segments have different dimensions");
+    }
+    starts_.push_back(starts_.back() + segment->lines());
+  }
+  this->n_lines_ = starts_.back();
+  this->is_traversed_ = true;
+}
+
+template <typename TRaw, typename Tf>
+void SegmentedData<TRaw, Tf>::GetFrames(int first, int count,
+                                        cv::Mat& out) const {
+  if (count < 0 || (count > 0 && first + count > this->n_lines_)) {
+    throw std::out_of_range("");
+  }
+  const int sizes[] = {count, this->n_bands_, this->n_samples_};
+  out.create(3, sizes, cv::DataType<uint16_t>::type);
+  // each segment decodes its part straight into the output cube
+  for (int i = first; i < first + count;) {
+    const auto loc = locate_(i);
+    const int n = std::min(first + count, starts_[loc.first + 1]) - i;
+    const int part_sizes[] = {n, this->n_bands_, this->n_samples_};
+    cv::Mat part(3, part_sizes, out.type(), out.ptr(i - first));
+    segments_[loc.first]->GetFrames(loc.second, n, part);
+    i += n;
+  }
+}
+
+}  // namespace hsp
+
+#endif  // HSP_DECODER_SEGMENTEDDATA_HPP_
@@ -0,0 +1,73 @@
+/**
+ * @file marker.hpp
+ * @author xiaoyc
+ * @brief 原始数据中同步字（帧引导头）的快速查找。
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef HSP_DECODER_MARKER_HPP_
+#define HSP_DECODER_MARKER_HPP_
+
+// C++ Standard
+#include <algorithm>
+#include <cstddef>
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define HSP_MARKER_SSE2
+#endif
+
+namespace hsp {
+
+/**
+ * @brief 在[first, last)中查找4字节同步字第一次出现的位置。
+ *
+ * @details
+ * 支持SSE2的平台上，每次比较16个候选起始位置：分别载入偏移0~3字节的16字节数据，
+ * 与同步字的4个字节逐字节比较后按位与，掩码中置位的比特即为同步字的起始位置。
+ * 剩余不足一个向量的部分使用std::search处理。
+ *
+ * @param first 查找范围起始
+ * @param last 查找范围末尾（不含）
+ * @param marker 4字节同步字
+ * @return const char* 同步字起始位置，未找到时返回last
+ */
+inline const char* find_marker(const char* first, const char* last,
+                               const char* marker) {
+#ifdef HSP_MARKER_SSE2
+  const __m128i m0 = _mm_set1_epi8(marker[0]);
+  const __m128i m1 = _mm_set1_epi8(marker[1]);
+  const __m128i m2 = _mm_set1_epi8(marker[2]);
+  const __m128i m3 = _mm_set1_epi8(marker[3]);
+  while (last - first >= 16 + 3) {
+    auto p = reinterpret_cast<const __m128i*>(first);
+    __m128i eq01 = _mm_and_si128(
+        _mm_cmpeq_epi8(_mm_loadu_si128(p), m0),
+        _mm_cmpeq_epi8(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(first + 1)), m1));
+    __m128i eq23 = _mm_and_si128(
+        _mm_cmpeq_epi8(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(first + 2)), m2),
+        _mm_cmpeq_epi8(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(first + 3)), m3));
+    int mask = _mm_movemask_epi8(_mm_and_si128(eq01, eq23));
+    if (mask != 0) {
+      for (int k = 0; k < 16; ++k) {
+        if (mask & (1 << k)) {
+          return first + k;
+        }
+      }
+    }
+    first += 16;
+  }
+#endif  // HSP_MARKER_SSE2
+  return std::search(first, last, marker, marker + 4);
+}
+
+}  // namespace hsp
+
+#endif  // HSP_DECODER_MARKER_HPP_
@@ -0,0 +1,214 @@
+/**
+ * @file envi.hpp
+ * @author xiaoyc
+ * @brief ENVI头文件解析与写出。
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef HSP_ENVI_HPP_
+#define HSP_ENVI_HPP_
+
+// C++ Standard
+#include <algorithm>
+#include <cstddef>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <set>
+#include <stdexcept>
+#include <string>
+
+// Boost
+#include <boost/algorithm/string.hpp>
+#include <boost/filesystem.hpp>
+
+namespace hsp {
+
+/**
+ * @brief ENVI头文件中的影像描述信息。
+ *
+ */
+struct EnviHeader {
+  /** @brief 每行像元数。 */
+  int samples = 0;
+  /** @brief 行数。 */
+  int lines = 0;
+  /** @brief 波段数。 */
+  int bands = 0;
+  /** @brief 数据文件中影像数据之前的字节数。 */
+  std::size_t header_offset = 0;
+  /** @brief ENVI数据类型代码，如12为16位无符号整型。 */
+  int data_type = 0;
+  /** @brief 交织方式，小写的"bsq"、"bil"或"bip"。 */
+  std::string interleave = "bsq";
+  /** @brief 字节序，0为小端，1为大端。 */
+  int byte_order = 0;
+  /** @brief 全部字段，键为小写，值为去除首尾空白（及花括号）后的原始文本。 */
+  std::map<std::string, std::string> fields;
+  /** @brief 原文中值写在花括号内的字段的键，写出时保持花括号。 */
+  std::set<std::string> braced;
+};
+
+/**
+ * @brief 查找数据文件对应的ENVI头文件。
+ *
+ * @details 依次尝试"数据文件名.hdr"和替换扩展名后的"数据文件名（无扩展名）.hdr"。
+ *
+ * @param datafile 数据文件路径
+ * @return std::string 头文件路径，未找到时返回空字符串
+ */
+inline std::string find_envi_header(const std::string& datafile) {
+  namespace fs = boost::filesystem;
+  for (auto&& candidate : {fs::path(datafile + ".hdr"),
+                           fs::path(datafile).replace_extension(".hdr")}) {
+    if (fs::exists(candidate)) {
+      return candidate.string();
+    }
+  }
+  return "";
+}
+
+/**
+ * @brief 解析ENVI头文件。
+ *
+ * @param hdrfile 头文件路径
+ * @return EnviHeader
+ */
+inline EnviHeader read_envi_header(const std::string& hdrfile) {
+  std::ifstream in(hdrfile);
+  std::string line;
+  if (!in || !std::getline(in, line) ||
+      boost::algorithm::trim_copy(line) != "ENVI") {
+    throw std::runtime_error("invalid ENVI header: " + hdrfile);
+  }
+  EnviHeader header;
+  while (std::getline(in, line)) {
+    const auto eq = line.find('=');
+    if (eq == std::string::npos) {
+      continue;
+    }
+    std::string key = boost::algorithm::to_lower_copy(
+        boost::algorithm::trim_copy(line.substr(0, eq)));
+    std::string value = boost::algorithm::trim_copy(line.substr(eq + 1));
+    // values in braces may span multiple lines
+    if (!value.empty() && value.front() == '{') {
+      while (value.find('}') == std::string::npos && std::getline(in, line)) {
+        value += "\n" + line;
+      }
+      value = boost::algorithm::trim_copy_if(
+          value, boost::algorithm::is_any_of("{} \t\r\n"));
+      header.braced.insert(key);
+    }
+    header.fields[key] = value;
+  }
+
+  auto field = [&](const char* key) -> const std::string* {
+    auto it = header.fields.find(key);
+    return it == header.fields.end() ? nullptr : &it->second;
+  };
+  try {
+    if (auto v = field("samples")) header.samples = std::stoi(*v);
+    if (auto v = field("lines")) header.lines = std::stoi(*v);
+    if (auto v = field("bands")) header.bands = std::stoi(*v);
+    if (auto v = field("header offset")) header.header_offset = std::stoull(*v);
+    if (auto v = field("data type")) header.data_type = std::stoi(*v);
+    if (auto v = field("byte order")) header.byte_order = std::stoi(*v);
+  } catch (const std::logic_error&) {
+    throw std::runtime_error("invalid ENVI header: " + hdrfile);
+  }
+  if (auto v = field("interleave")) {
+    header.interleave = boost::algorithm::to_lower_copy(*v);
+  }
+  if (header.samples <= 0 || header.bands <= 0) {
+    throw std::runtime_error("invalid ENVI header: " + hdrfile);
+  }
+  return header;
+}
+
+/**
+ * @brief ENVI数据类型代码对应的像元字节数。
+ *
+ * @param data_type ENVI数据类型代码
+ * @return int 字节数，不支持的类型返回0
+ */
+inline int envi_data_type_size(int data_type) {
+  switch (data_type) {
+    case 1:
+      return 1;
+    case 2:
+    case 12:
+      return 2;
+    case 3:
+    case 4:
+    case 13:
+      return 4;
+    case 5:
+    case 6:
+    case 14:
+    case 15:
+      return 8;
+    case 9:
+      return 16;
+    default:
+      return 0;
+  }
+}
+
+/**
+ * @brief 写出ENVI头文件。
+ *
+ * @details
+ * 先写出描述影像的字段，再按原样写出header.fields中的其他字段。
+ * header.braced中的字段、ENVI规定为列表或文本的字段（如wavelength、description）
+ * 以及含换行的值写在花括号内。
+ *
+ * @param hdrfile 头文件路径
+ * @param header 影像描述信息
+ */
+inline void write_envi_header(const std::string& hdrfile,
+                              const EnviHeader& header) {
+  std::ofstream out(hdrfile);
+  if (!out) {
+    throw std::runtime_error("unable to write ENVI header: " + hdrfile);
+  }
+  out << "ENVI\n"
+      << "samples = " << header.samples << "\n"
+      << "lines   = " << header.lines << "\n"
+      << "bands   = " << header.bands << "\n"
+      << "header offset = " << header.header_offset << "\n"
+      << "file type = ENVI Standard\n"
+      << "data type = " << header.data_type << "\n"
+      << "interleave = " << header.interleave << "\n"
+      << "byte order = " << header.byte_order << "\n";
+  static const char* written[] = {
+      "samples",   "lines",     "bands",      "header offset",
+      "file type", "data type", "interleave", "byte order"};
+  static const std::set<std::string> list_fields = {
+      "band names", "bbl", "class lookup", "class names",
+      "coordinate system string", "data gain values", "data offset values",
+      "default bands", "description", "fwhm", "map info", "projection info",
+      "spectra names", "wavelength"};
+  for (auto&& field : header.fields) {
+    if (std::find_if(std::begin(written), std::end(written),
+                     [&](const char* key) { return field.first == key; }) !=
+        std::end(written)) {
+      continue;
+    }
+    if (field.second.find('\n') != std::string::npos ||
+        header.braced.count(field.first) || list_fields.count(field.first)) {
+      out << field.first << " = {" << field.second << "}\n";
+    } else {
+      out << field.first << " = " << field.second << "\n";
+    }
+  }
+  if (!out) {
+    throw std::runtime_error("unable to write ENVI header: " + hdrfile);
+  }
+}
+
+}  // namespace hsp
+
+#endif  // HSP_ENVI_HPP_
@@ -0,0 +1,235 @@
+/**
+ * @file executor.hpp
+ * @author xiaoyc
+ * @brief 多线程保序流水线：读取、并行处理、按顺序写出。
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef HSP_EXECUTOR_HPP_
+#define HSP_EXECUTOR_HPP_
+
+// C++ Standard
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// OpenCV
+#include <opencv2/core.hpp>
+
+namespace hsp {
+
+namespace detail {
+
+/** @brief 操作提供apply()（见UnaryOperation::apply()）时写入out，复用其内存。 */
+template <typename UnaryOp>
+auto apply_op_(const UnaryOp& op, const cv::Mat& in, cv::Mat& out, int)
+    -> decltype(op.apply(in, out), void()) {
+  op.apply(in, out);
+}
+
+/** @brief 其他可调用对象，形如cv::Mat(const cv::Mat&)。 */
+template <typename UnaryOp>
+void apply_op_(const UnaryOp& op, const cv::Mat& in, cv::Mat& out,
+               long) {  // NOLINT
+  out = op(in);
+}
+
+}  // namespace detail
+
+/**
+ * @brief 多线程保序版本的std::transform：读取、处理、写出三级流水线。
+ *
+ * @details
+ * - 读取：一个读取线程遍历[first, last)，把每个切片复制到一个空闲槽位；
+ * - 处理：num_threads个工作线程从任务队列中取出槽位，并行调用op；
+ * - 写出：调用线程按读取顺序等待各槽位处理完成，依次赋给out。
+ *
+ * 槽位共max_in_flight个，第k个切片使用第k % max_in_flight个槽位，
+ * 槽位在结果写出后才会被读取线程复用，因此在途的切片数和内存占用有上限，
+ * 输入、输出缓冲区也在槽位中反复复用。
+ * op提供apply(in, out)时（如hsp::UnaryOpCombo）直接写入槽位的输出缓冲区，
+ * 稳定后处理过程不再分配内存。
+ *
+ * 输入和输出迭代器各自只在一个线程中使用，与std::transform的要求相同；
+ * op会被多个工作线程同时调用，需要是线程安全的（辐射校正算法和hsp::UnaryOpCombo均满足）。
+ * 赋给out的结果矩阵之后会被复用，out需要在赋值时写出或复制数据，
+ * hsp::LineOutputIterator等输出迭代器满足这一要求。
+ *
+ * 读取、处理或写出抛出异常时停止流水线，等待各线程退出后，在调用线程重新抛出
+ * 按切片顺序最早的异常。
+ *
+ * @code{.cpp}
+ *  hsp::LineInputIterator<uint16_t> beg(src_dataset.get(), 0),
+ *      end(src_dataset.get());
+ *  hsp::LineOutputIterator<uint16_t> obeg(dst_dataset.get(), 0);
+ *  obeg = hsp::ordered_transform(beg, end, obeg, ops, 16);
+ *  obeg.close();
+ * @endcode
+ *
+ * @tparam InputIt 输入迭代器，解引用为cv::Mat
+ * @tparam OutputIt 输出迭代器，可赋值cv::Mat
+ * @tparam UnaryOp 一元操作，提供apply(in, out)或形如cv::Mat(const cv::Mat&)
+ * @param first 输入起始位置
+ * @param last 输入结束位置
+ * @param out 输出起始位置
+ * @param op 一元操作
+ * @param num_threads 工作线程数，不大于0时为cv::getNumThreads()
+ * @param max_in_flight 在途切片数上限，不大于0时为工作线程数的2倍
+ * @return OutputIt 指向最后一个写出位置之后
+ */
+template <typename InputIt, typename OutputIt, typename UnaryOp>
+OutputIt ordered_transform(InputIt first, InputIt last, OutputIt out,
+                           const UnaryOp& op, int num_threads = 0,
+                           int max_in_flight = 0) {
+  if (num_threads <= 0) {
+    num_threads = std::max(cv::getNumThreads(), 1);
+  }
+  if (max_in_flight <= 0) {
+    max_in_flight = 2 * num_threads;
+  }
+
+  enum class State { Free, Read, Done };
+  struct Slot {
+    cv::Mat input;
+    cv::Mat output;
+    long seq{-1};
+    State state{State::Free};
+    std::exception_ptr error;
+  };
+  std::vector<Slot> slots(max_in_flight);
+  auto slot_of = [&](long seq) -> Slot& {
+    return slots[static_cast<std::size_t>(seq % max_in_flight)];
+  };
+
+  std::mutex mutex;
+  std::condition_variable slot_freed, job_ready, slot_done;
+  std::deque<long> jobs;
+  long total = 0;
+  bool reader_done = false;
+  bool abort = false;
+  std::exception_ptr reader_error;
+
+  std::thread reader([&] {
+    long seq = 0;
+    try {
+      for (; first != last; ++seq) {
+        Slot& slot = slot_of(seq);
+        {
+          std::unique_lock<std::mutex> lock(mutex);
+          slot_freed.wait(
+              lock, [&] { return slot.state == State::Free || abort; });
+          if (abort) {
+            break;
+          }
+        }
+        // the iterator may reuse its buffer, so the slice is copied
+        const cv::Mat& value = *first;
+        value.copyTo(slot.input);
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          slot.seq = seq;
+          slot.state = State::Read;
+          slot.error = nullptr;
+          jobs.push_back(seq);
+        }
+        job_ready.notify_one();
+        ++first;
+      }
+    } catch (...) {
+      reader_error = std::current_exception();
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      total = seq;
+      reader_done = true;
+    }
+    job_ready.notify_all();
+    slot_done.notify_all();
+  });
+
+  std::vector<std::thread> workers;
+  for (int t = 0; t < num_threads; ++t) {
+    workers.emplace_back([&] {
+      for (;;) {
+        long seq;
+        {
+          std::unique_lock<std::mutex> lock(mutex);
+          job_ready.wait(
+              lock, [&] { return !jobs.empty() || reader_done || abort; });
+          if (abort || jobs.empty()) {
+            return;
+          }
+          seq = jobs.front();
+          jobs.pop_front();
+        }
+        Slot& slot = slot_of(seq);
+        try {
+          detail::apply_op_(op, slot.input, slot.output, 0);
+        } catch (...) {
+          slot.error = std::current_exception();
+        }
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          slot.state = State::Done;
+        }
+        slot_done.notify_all();
+      }
+    });
+  }
+
+  std::exception_ptr error;
+  try {
+    for (long seq = 0;; ++seq) {
+      Slot& slot = slot_of(seq);
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        slot_done.wait(lock, [&] {
+          return (slot.state == State::Done && slot.seq == seq) ||
+                 (reader_done && seq >= total);
+        });
+        if (reader_done && seq >= total) {
+          break;
+        }
+      }
+      if (slot.error) {
+        std::rethrow_exception(slot.error);
+      }
+      *out = slot.output;
+      ++out;
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        slot.state = State::Free;
+      }
+      slot_freed.notify_one();
+    }
+    error = reader_error;
+  } catch (...) {
+    error = std::current_exception();
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    abort = true;
+  }
+  slot_freed.notify_all();
+  job_ready.notify_all();
+  reader.join();
+  for (auto&& worker : workers) {
+    worker.join();
+  }
+  if (error) {
+    std::rethrow_exception(error);
+  }
+  return out;
+}
+
+}  // namespace hsp
+
+#endif  // HSP_EXECUTOR_HPP_
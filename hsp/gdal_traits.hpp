@@ -16,6 +16,9 @@
 
 // C++ Standard
 #include <complex>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
 
 namespace hsp {
 namespace gdal {
@@ -104,6 +107,55 @@ class DataType<std::complex<double> > {
   static GDALDataType type() { return GDT_CFloat64; }
 };
 
+/**
+ * @brief 携带类型的空标签，用于把运行期的类型分派到泛型lambda。
+ *
+ * @tparam _Tp 数据类型
+ */
+template <typename _Tp>
+struct TypeTag {
+  typedef _Tp type;
+};
+
+/**
+ * @brief 按GDAL数据类型type在运行期分派一次，以对应C++类型的TypeTag调用f。
+ *
+ * @details
+ * 只支持OpenCV能表示的实数类型：Byte、UInt16、Int16、Int32、Float32和Float64。
+ * f通常是泛型lambda，各类型的返回值类型必须相同：
+ * @code{.cpp}
+ *  hsp::gdal::visit_data_type(type, [&](auto tag) {
+ *    using T = typename decltype(tag)::type;
+ *    process<T>(dataset);
+ *  });
+ * @endcode
+ *
+ * @param type GDAL定义的数据类型
+ * @param f 可调用对象，以TypeTag<T>调用
+ * @return f的返回值
+ */
+template <typename F>
+auto visit_data_type(GDALDataType type, F&& f)
+    -> decltype(f(TypeTag<unsigned char>())) {
+  switch (type) {
+    case GDT_Byte:
+      return f(TypeTag<unsigned char>());
+    case GDT_UInt16:
+      return f(TypeTag<uint16_t>());
+    case GDT_Int16:
+      return f(TypeTag<int16_t>());
+    case GDT_Int32:
+      return f(TypeTag<int32_t>());
+    case GDT_Float32:
+      return f(TypeTag<float>());
+    case GDT_Float64:
+      return f(TypeTag<double>());
+    default:
+      throw std::invalid_argument(std::string("unsupported data type ") +
+                                  GDALGetDataTypeName(type));
+  }
+}
+
 }  // namespace gdal
 }  // namespace hsp
 
@@ -48,6 +48,10 @@ inline const char* GetGDALDescription(const char* ext,
       {"tif", "GTiff"},
       {"tiff", "GTiff"},
       {"dat", "ENVI"},
+      {"img", "ENVI"},
+      {"bsq", "ENVI"},
+      {"bil", "ENVI"},
+      {"bip", "ENVI"},
       {"bmp", "BMP"},
       {"jpg", "JPEG"}};
   std::string ext_str(ext);
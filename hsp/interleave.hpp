@@ -0,0 +1,309 @@
+/**
+ * @file interleave.hpp
+ * @author xiaoyc
+ * @brief 数据立方交织方式（BSQ/BIL/BIP）转换。
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef HSP_INTERLEAVE_HPP_
+#define HSP_INTERLEAVE_HPP_
+
+// GDAL
+#include <cpl_conv.h>
+#include <gdal.h>
+#include <gdal_priv.h>
+
+// C++ Standard
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+// OpenCV
+#include <opencv2/core.hpp>
+
+// project
+#include "./gdalex.hpp"
+#include "./transpose.hpp"
+
+namespace hsp {
+
+/**
+ * @brief 交织方式。
+ *
+ */
+enum class Interleave {
+  BSQ, /**< 按波段顺序存储，GDAL中为INTERLEAVE=BAND */
+  BIL, /**< 按行交织，GDAL中为INTERLEAVE=LINE */
+  BIP  /**< 按像元交织，GDAL中为INTERLEAVE=PIXEL */
+};
+
+/**
+ * @brief 由名称解析交织方式，接受BSQ/BIL/BIP及GDAL的BAND/LINE/PIXEL，不区分大小写。
+ *
+ * @param name 交织方式名称
+ * @return Interleave
+ */
+inline Interleave parse_interleave(std::string name) {
+  std::transform(name.begin(), name.end(), name.begin(),
+                 [](unsigned char c) { return std::toupper(c); });
+  if (name == "BSQ" || name == "BAND") {
+    return Interleave::BSQ;
+  }
+  if (name == "BIL" || name == "LINE") {
+    return Interleave::BIL;
+  }
+  if (name == "BIP" || name == "PIXEL") {
+    return Interleave::BIP;
+  }
+  throw std::invalid_argument("unknown interleave: " + name);
+}
+
+/**
+ * @brief 数据集的交织方式，取自IMAGE_STRUCTURE元数据，缺省为BSQ。
+ *
+ * @param dataset 数据集指针
+ * @return Interleave
+ */
+inline Interleave interleave_of(GDALDataset* dataset) {
+  const char* name = dataset->GetMetadataItem("INTERLEAVE", "IMAGE_STRUCTURE");
+  return name ? parse_interleave(name) : Interleave::BSQ;
+}
+
+namespace detail {
+
+/**
+ * @brief 一块数据在内存中的布局，以元素个数表示的波段、行、像元间距。
+ *
+ */
+struct CubeLayout {
+  std::ptrdiff_t band;
+  std::ptrdiff_t line;
+  std::ptrdiff_t pixel;
+
+  /** @brief lines行的数据块按交织方式interleave连续存放时的布局。 */
+  static CubeLayout of(Interleave interleave, int samples, int lines,
+                       int bands) {
+    const std::ptrdiff_t ns = samples, nl = lines, nb = bands;
+    switch (interleave) {
+      case Interleave::BSQ:
+        return {nl * ns, ns, 1};
+      case Interleave::BIL:
+        return {ns, nb * ns, 1};
+      case Interleave::BIP:
+      default:
+        return {1, ns * nb, nb};
+    }
+  }
+};
+
+/** @brief 16字节元素（如CFloat64），仅用于搬运。 */
+struct Element16 {
+  uint64_t v[2];
+};
+
+/**
+ * @brief 按布局src_layout读入的数据块重排为布局dst_layout。
+ *
+ * @details
+ * 每行是一个 bands * samples 的矩阵：BSQ和BIL中像元连续，BIP中波段连续。
+ * 像元均连续时按波段整行复制，否则为一次分块转置。各行并行处理。
+ */
+template <typename T>
+void relayout(const T* src, const CubeLayout& src_layout, T* dst,
+              const CubeLayout& dst_layout, int samples, int lines,
+              int bands) {
+  cv::parallel_for_(cv::Range(0, lines), [&](const cv::Range& range) {
+    for (int y = range.start; y < range.end; ++y) {
+      const T* in = src + y * src_layout.line;
+      T* out = dst + y * dst_layout.line;
+      if (src_layout.pixel == 1 && dst_layout.pixel == 1) {
+        for (int b = 0; b < bands; ++b) {
+          std::copy(in + b * src_layout.band,
+                    in + b * src_layout.band + samples,
+                    out + b * dst_layout.band);
+        }
+      } else if (src_layout.pixel == 1) {
+        transpose_2d(in, src_layout.band, out, dst_layout.pixel, bands,
+                     samples);
+      } else {
+        transpose_2d(in, src_layout.pixel, out, dst_layout.band, samples,
+                     bands);
+      }
+    }
+  });
+}
+
+/** @brief 按元素大小分派relayout()，转置与数据类型无关。 */
+inline void relayout(const void* src, const CubeLayout& src_layout, void* dst,
+                     const CubeLayout& dst_layout, int element_size,
+                     int samples, int lines, int bands) {
+  switch (element_size) {
+    case 1:
+      relayout(static_cast<const uint8_t*>(src), src_layout,
+               static_cast<uint8_t*>(dst), dst_layout, samples, lines, bands);
+      break;
+    case 2:
+      relayout(static_cast<const uint16_t*>(src), src_layout,
+               static_cast<uint16_t*>(dst), dst_layout, samples, lines, bands);
+      break;
+    case 4:
+      relayout(static_cast<const uint32_t*>(src), src_layout,
+               static_cast<uint32_t*>(dst), dst_layout, samples, lines, bands);
+      break;
+    case 8:
+      relayout(static_cast<const uint64_t*>(src), src_layout,
+               static_cast<uint64_t*>(dst), dst_layout, samples, lines, bands);
+      break;
+    case 16:
+      relayout(static_cast<const Element16*>(src), src_layout,
+               static_cast<Element16*>(dst), dst_layout, samples, lines,
+               bands);
+      break;
+    default:
+      throw std::invalid_argument("unsupported data type");
+  }
+}
+
+/** @brief 按布局layout读写数据集第y0行起的lines行。 */
+inline CPLErr cube_io(GDALRWFlag rw, GDALDataset* dataset, int y0, int lines,
+                      void* data, GDALDataType type,
+                      const CubeLayout& layout) {
+  const GSpacing elem = GDALGetDataTypeSizeBytes(type);
+  return dataset->RasterIO(rw, 0, y0, dataset->GetRasterXSize(), lines, data,
+                           dataset->GetRasterXSize(), lines, type,
+                           dataset->GetRasterCount(), nullptr,
+                           elem * layout.pixel, elem * layout.line,
+                           elem * layout.band);
+}
+
+}  // namespace detail
+
+/**
+ * @brief 将数据集src按dst的交织方式写入dst。
+ *
+ * @details
+ * 以整行为单位分块处理，单块行数由内存上限max_memory决定，总内存占用为两个块缓冲区。
+ * 每块先按源数据的交织方式读入（使GDAL的读取连续），在内存中分块转置为目标交织方式后，
+ * 再以目标的交织方式一次写出。相比逐波段读取、逐行写入，每块数据只读写一次。
+ * 目标的交织方式取自其IMAGE_STRUCTURE元数据。
+ *
+ * @param src 源数据集
+ * @param dst 目标数据集，尺寸和波段数与src一致；数据类型不同时由GDAL转换
+ * @param max_memory 缓冲区内存上限（字节），至少容纳一行
+ */
+inline void convert_interleave(GDALDataset* src, GDALDataset* dst,
+                               std::size_t max_memory = 256 << 20) {
+  if (!src || !dst) {
+    throw std::runtime_error("Convert interleave with nullptr!");
+  }
+  const int ns = src->GetRasterXSize();
+  const int nl = src->GetRasterYSize();
+  const int nb = src->GetRasterCount();
+  if (dst->GetRasterXSize() != ns || dst->GetRasterYSize() != nl ||
+      dst->GetRasterCount() != nb) {
+    throw std::invalid_argument("source and destination differ in size");
+  }
+  if (nb == 0 || nl == 0 || ns == 0) {
+    return;
+  }
+  const Interleave src_interleave = interleave_of(src);
+  const Interleave dst_interleave = interleave_of(dst);
+  const GDALDataType type = src->GetRasterBand(1)->GetRasterDataType();
+  const int elem = GDALGetDataTypeSizeBytes(type);
+  const std::size_t line_size = static_cast<std::size_t>(elem) * ns * nb;
+  const bool same = src_interleave == dst_interleave;
+  const int chunk = static_cast<int>(std::max<std::size_t>(
+      1, std::min<std::size_t>(nl, max_memory / (same ? 1 : 2) / line_size)));
+
+  std::unique_ptr<char[]> read_buffer(new char[line_size * chunk]);
+  std::unique_ptr<char[]> write_buffer(same ? nullptr
+                                            : new char[line_size * chunk]);
+  for (int y0 = 0; y0 < nl; y0 += chunk) {
+    const int lines = std::min(chunk, nl - y0);
+    const auto src_layout =
+        detail::CubeLayout::of(src_interleave, ns, lines, nb);
+    const auto dst_layout =
+        detail::CubeLayout::of(dst_interleave, ns, lines, nb);
+    if (detail::cube_io(GF_Read, src, y0, lines, read_buffer.get(), type,
+                        src_layout) == CE_Failure) {
+      throw std::runtime_error("unable to read source");
+    }
+    char* out = read_buffer.get();
+    if (!same) {
+      out = write_buffer.get();
+      detail::relayout(read_buffer.get(), src_layout, out, dst_layout, elem,
+                       ns, lines, nb);
+    }
+    if (detail::cube_io(GF_Write, dst, y0, lines, out, type, dst_layout) ==
+        CE_Failure) {
+      throw std::runtime_error("unable to write destination");
+    }
+  }
+}
+
+/**
+ * @brief 将文件src_file转换为交织方式为interleave的文件dst_file。
+ *
+ * @details
+ * 目标驱动由dst_file的后缀决定（见gdal::GetGDALDescription()），数据类型与源数据一致。
+ * GTiff仅支持BSQ和BIP。
+ *
+ * @param src_file 源文件路径
+ * @param dst_file 目标文件路径
+ * @param interleave 目标交织方式
+ * @param max_memory 缓冲区内存上限（字节）
+ */
+inline void convert_interleave(const std::string& src_file,
+                               const std::string& dst_file,
+                               Interleave interleave,
+                               std::size_t max_memory = 256 << 20) {
+  auto src = GDALDatasetUniquePtr(
+      GDALDataset::FromHandle(GDALOpen(src_file.c_str(), GA_ReadOnly)));
+  if (!src) {
+    throw std::runtime_error("unable to open " + src_file);
+  }
+  const auto dot = dst_file.find_last_of('.');
+  const std::string driver_name = gdal::GetGDALDescription(
+      dot == std::string::npos ? "dat" : dst_file.c_str() + dot + 1, "ENVI");
+  const bool is_tiff = driver_name == "GTiff";
+  const char* option = nullptr;
+  switch (interleave) {
+    case Interleave::BSQ:
+      option = is_tiff ? "BAND" : "BSQ";
+      break;
+    case Interleave::BIL:
+      if (is_tiff) {
+        throw std::invalid_argument("GTiff does not support BIL");
+      }
+      option = "BIL";
+      break;
+    case Interleave::BIP:
+      option = is_tiff ? "PIXEL" : "BIP";
+      break;
+  }
+  auto driver = GetGDALDriverManager()->GetDriverByName(driver_name.c_str());
+  if (!driver) {
+    throw std::runtime_error("unable to find driver " + driver_name);
+  }
+  char** options = CSLSetNameValue(nullptr, "INTERLEAVE", option);
+  auto dst = GDALDatasetUniquePtr(driver->Create(
+      dst_file.c_str(), src->GetRasterXSize(), src->GetRasterYSize(),
+      src->GetRasterCount(), src->GetRasterBand(1)->GetRasterDataType(),
+      options));
+  CSLDestroy(options);
+  if (!dst) {
+    throw std::runtime_error("unable to create " + dst_file);
+  }
+  convert_interleave(src.get(), dst.get(), max_memory);
+}
+
+}  // namespace hsp
+
+#endif  // HSP_INTERLEAVE_HPP_
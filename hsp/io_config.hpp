@@ -0,0 +1,270 @@
+/**
+ * @file io_config.hpp
+ * @author xiaoyc
+ * @brief 每个作业的GDAL块缓存与读写参数。
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef HSP_IO_CONFIG_HPP_
+#define HSP_IO_CONFIG_HPP_
+
+// GDAL
+#include <cpl_conv.h>
+#include <gdal.h>
+#include <gdal_priv.h>
+
+// C++ Standard
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+// project
+#include "./interleave.hpp"
+
+namespace hsp {
+namespace gdal {
+
+/**
+ * @brief GDAL读写参数。
+ *
+ * @details
+ * 同一台机器上并行运行多个作业时，各作业默认的GDAL块缓存（物理内存的5%）和单线程解压
+ * 会导致内存争用或CPU空闲。本结构集中描述一个作业的读写参数：
+ * - 进程级参数：块缓存上限GDAL_CACHEMAX、解压线程数GDAL_NUM_THREADS，由apply()设置；
+ * - 创建参数：分块、交织方式、压缩方式及其他驱动选项，由create()使用；
+ * - 迭代参数：AdviseRead预读窗口、异步预取深度、异步写入队列深度，由迭代器使用。
+ *
+ * 各项取默认值时不改变GDAL和迭代器原有的行为。describe()给出生效的参数，用于记录作业日志。
+ *
+ * @par Sample
+ * @code{.cpp}
+ *  hsp::gdal::IOConfig io;
+ *  io.cache_max_mb = 512;
+ *  io.num_threads = 2;
+ *  io.block_x = io.block_y = 256;
+ *  io.apply();
+ *  spdlog::info("GDAL I/O: {}", io.describe());
+ *  auto dst = io.create("GTiff", "out.tif", ns, nl, nb, GDT_UInt16);
+ *  hsp::LineInputIterator<uint16_t> beg(src, 0, io), end(src);
+ *  hsp::LineOutputIterator<uint16_t> out(dst, 0, io);
+ * @endcode
+ */
+struct IOConfig {
+  /** @brief 块缓存上限（MB），0为不修改。 */
+  int cache_max_mb = 0;
+  /** @brief 解压线程数（GDAL_NUM_THREADS），0为不修改，-1为全部CPU。 */
+  int num_threads = 0;
+  /** @brief 创建GTiff数据集时的分块宽度，0为不分块。 */
+  int block_x = 0;
+  /** @brief 创建GTiff数据集时的分块高度（不分块时为条带行数），0为驱动默认。 */
+  int block_y = 0;
+  /** @brief 创建数据集时的交织方式BSQ/BIL/BIP，空为驱动默认。 */
+  std::string interleave;
+  /** @brief 创建数据集时的压缩方式（COMPRESS），空为不压缩。 */
+  std::string compress;
+  /** @brief 其他创建选项，键值对原样传给驱动，优先于上述选项。 */
+  std::map<std::string, std::string> options;
+  /** @brief 输入迭代器每次通过AdviseRead()提示的切片数，0为不提示。 */
+  int advise_read = 0;
+  /** @brief 输入迭代器异步预取的切片数，0为不预取。 */
+  int prefetch = 0;
+  /** @brief 输出迭代器异步写入的队列深度，0为同步写入。 */
+  int write_queue = 0;
+
+  /**
+   * @brief 设置进程级参数：块缓存上限和解压线程数。
+   *
+   * @note GDAL的这两项设置对整个进程生效，应在打开数据集之前调用。
+   */
+  void apply() const {
+    if (cache_max_mb > 0) {
+      GDALSetCacheMax64(static_cast<int64_t>(cache_max_mb) << 20);
+    }
+    if (num_threads != 0) {
+      CPLSetConfigOption(
+          "GDAL_NUM_THREADS",
+          num_threads < 0 ? "ALL_CPUS" : std::to_string(num_threads).c_str());
+    }
+  }
+
+  /**
+   * @brief 用于驱动driver_name的创建选项。
+   *
+   * @param driver_name 驱动名称，如"GTiff"、"ENVI"
+   * @return std::vector<std::pair<std::string, std::string>>
+   */
+  std::vector<std::pair<std::string, std::string>> creation_options(
+      const std::string& driver_name) const;
+
+  /**
+   * @brief 按本参数创建数据集。
+   *
+   * @param driver_name 驱动名称
+   * @param filepath 待创建文件路径
+   * @param cols 列数（即samples）
+   * @param rows 行数（即lines）
+   * @param bands 波段数
+   * @param type 像元数据类型
+   * @return GDALDataset* 创建失败时返回nullptr
+   */
+  GDALDataset* create(const char* driver_name, const char* filepath, int cols,
+                      int rows, int bands, GDALDataType type) const;
+
+  /**
+   * @brief 生效的参数，用于作业日志。
+   *
+   * @return std::string
+   */
+  std::string describe() const;
+};
+
+inline std::vector<std::pair<std::string, std::string>>
+IOConfig::creation_options(const std::string& driver_name) const {
+  std::vector<std::pair<std::string, std::string>> result;
+  const bool is_tiff = driver_name == "GTiff";
+  // other drivers (e.g. ENVI) do not know the block options
+  if (is_tiff && block_x > 0) {
+    result.emplace_back("TILED", "YES");
+    result.emplace_back("BLOCKXSIZE", std::to_string(block_x));
+  }
+  if (is_tiff && block_y > 0) {
+    result.emplace_back("BLOCKYSIZE", std::to_string(block_y));
+  }
+  if (!interleave.empty()) {
+    static const char* tiff_names[] = {"BAND", "LINE", "PIXEL"};
+    static const char* envi_names[] = {"BSQ", "BIL", "BIP"};
+    const int k = static_cast<int>(parse_interleave(interleave));
+    if (is_tiff && k == static_cast<int>(Interleave::BIL)) {
+      throw std::invalid_argument("GTiff does not support BIL");
+    }
+    result.emplace_back("INTERLEAVE", is_tiff ? tiff_names[k] : envi_names[k]);
+  }
+  if (!compress.empty()) {
+    result.emplace_back("COMPRESS", compress);
+  }
+  for (auto&& option : options) {
+    auto it = std::find_if(result.begin(), result.end(), [&](const auto& r) {
+      return r.first == option.first;
+    });
+    if (it != result.end()) {
+      it->second = option.second;
+    } else {
+      result.push_back(option);
+    }
+  }
+  return result;
+}
+
+inline GDALDataset* IOConfig::create(const char* driver_name,
+                                     const char* filepath, int cols, int rows,
+                                     int bands, GDALDataType type) const {
+  auto driver = GetGDALDriverManager()->GetDriverByName(driver_name);
+  if (!driver) {
+    return nullptr;
+  }
+  char** papszOptions{nullptr};
+  for (auto&& option : creation_options(driver_name)) {
+    papszOptions = CSLSetNameValue(papszOptions, option.first.c_str(),
+                                   option.second.c_str());
+  }
+  auto dataset = driver->Create(filepath, cols, rows, bands, type,
+                                papszOptions);
+  CSLDestroy(papszOptions);
+  return dataset;
+}
+
+inline std::string IOConfig::describe() const {
+  std::ostringstream out;
+  out << "GDAL_CACHEMAX=" << (GDALGetCacheMax64() >> 20) << "MB"
+      << " GDAL_NUM_THREADS=" << CPLGetConfigOption("GDAL_NUM_THREADS", "1");
+  if (block_x > 0 || block_y > 0) {
+    out << " block=" << block_x << "x" << block_y;
+  }
+  if (!interleave.empty()) {
+    out << " interleave=" << interleave;
+  }
+  if (!compress.empty()) {
+    out << " compress=" << compress;
+  }
+  for (auto&& option : options) {
+    out << " " << option.first << "=" << option.second;
+  }
+  out << " advise_read=" << advise_read << " prefetch=" << prefetch
+      << " write_queue=" << write_queue;
+  return out.str();
+}
+
+/**
+ * @brief 提示GDAL即将读取的样本/行/波段范围，以便驱动提前读取或解压。
+ *
+ * @param dataset 数据集指针
+ * @param dim 切片维度，1为样本，2为行，3为波段
+ * @param first 第一个切片，从0开始计数
+ * @param count 切片数
+ */
+inline void AdviseSlices(GDALDataset* dataset, unsigned dim, int first,
+                         int count) {
+  const int ns = dataset->GetRasterXSize();
+  const int nl = dataset->GetRasterYSize();
+  const int nb = dataset->GetRasterCount();
+  switch (dim) {
+    case 1:
+      count = std::min(count, ns - first);
+      if (count > 0) {
+        dataset->AdviseRead(first, 0, count, nl, count, nl, GDT_Unknown, nb,
+                            nullptr, nullptr);
+      }
+      break;
+    case 2:
+      count = std::min(count, nl - first);
+      if (count > 0) {
+        dataset->AdviseRead(0, first, ns, count, ns, count, GDT_Unknown, nb,
+                            nullptr, nullptr);
+      }
+      break;
+    default: {
+      count = std::min(count, nb - first);
+      if (count > 0) {
+        std::vector<int> band_list(count);
+        for (int k = 0; k < count; ++k) {
+          band_list[k] = first + k + 1;
+        }
+        dataset->AdviseRead(0, 0, ns, nl, ns, nl, GDT_Unknown, count,
+                            band_list.data(), nullptr);
+      }
+    }
+  }
+}
+
+/**
+ * @brief 根据待创建文件名的后缀选择驱动，并按读写参数config创建数据集。
+ *
+ * @param filepath 待创建文件路径
+ * @param cols 待创建数据集的列数（即 samples）
+ * @param rows 待创建数据集的行数（即 lines）
+ * @param bands 待创建数据集的波段数
+ * @param type 待创建数据集的像元数据类型
+ * @param config 读写参数
+ * @return GDALDataset*
+ */
+inline GDALDataset* GDALCreate(const char* filepath, int cols, int rows,
+                               int bands, GDALDataType type,
+                               const IOConfig& config) {
+  const char* ext = strrchr(filepath, '.');
+  return config.create(GetGDALDescription(ext ? ext : "tif", "ENVI"),
+                       filepath, cols, rows, bands, type);
+}
+
+}  // namespace gdal
+}  // namespace hsp
+
+#endif  // HSP_IO_CONFIG_HPP_
@@ -1,7 +1,7 @@
 /**
  * @file iterator.hpp
  * @author xiaoyc
- * @brief 实现了对GDALDataset按照样本、行、波段进行迭代的输入输出迭代器。
+ * @brief 实现了对GDALDataset按照样本、行、波段和分块进行迭代的输入输出迭代器。
  * @version 0.1
  * @date 2023-09-21
  *
@@ -16,7 +16,14 @@
 #include <gdal_priv.h>
 
 // C++ Standard
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
 #include <exception>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
 
 // Boost
 #include <boost/iterator/iterator_facade.hpp>
@@ -25,7 +32,9 @@
 #include <opencv2/core.hpp>
 
 // project
+#include "./concurrency.hpp"
 #include "./gdal_traits.hpp"
+#include "./io_config.hpp"
 
 namespace hsp {
 
@@ -43,6 +52,11 @@ namespace hsp {
  *
  * 在实例化时，如果指定了当前的样本/行/波段号（均从0开始计数），那么当前数据会在构造函数中预读取。如果不指定，那么该实例为末端迭代器，仅用于表示数据集的末尾。
  *
+ * 默认情况下，自增时同步读取下一个切片，并覆盖同一个缓冲区，之前解引用得到的cv::Mat随之改变。
+ * 构造时指定预取深度后启用异步预取：后台线程提前读取之后的若干切片，处理当前切片与磁盘读取重叠进行；
+ * 每个切片使用独立的缓冲区，解引用得到的cv::Mat在使用者释放之前一直有效。
+ * 预取期间数据集只由后台线程访问，其他线程不应同时读写同一个数据集。
+ *
  * 本迭代器类通过指定类型，特化为SampleInputIterator、LineInputIterator和BandInputIterator。
  */
 template <typename T, unsigned N>
@@ -53,6 +67,8 @@ class InputIterator_
 
  public:
   using reference = cv::Mat const&;
+  /** @brief 读取影像像元的数据类型。 */
+  using pixel_type = T;
   /**
    * @brief 仅用于构造末端迭代器，用于表示数据集的末尾
    *
@@ -90,35 +106,55 @@ class InputIterator_
       n_samples_ = dataset->GetRasterXSize();
       n_lines_ = dataset->GetRasterYSize();
       n_bands_ = dataset->GetRasterCount();
-      CPLErr err;
-      switch (N) {
-        case 1:
-          img_ = cv::Mat::zeros(cv::Size(n_lines_, n_bands_),
-                                cv::DataType<T>::type);
-          err = dataset_->RasterIO(GF_Read, cur_, 0, 1, n_lines_, img_.data, 1,
-                                   n_lines_, gdal::DataType<T>::type(),
-                                   n_bands_, nullptr, 0, 0, 0);
-          max_idx_ = n_samples_;
-          break;
-        case 2:
-          img_ = cv::Mat::zeros(cv::Size(n_samples_, n_bands_),
-                                cv::DataType<T>::type);
-          err = dataset_->RasterIO(GF_Read, 0, cur_, n_samples_, 1, img_.data,
-                                   n_samples_, 1, gdal::DataType<T>::type(),
-                                   n_bands_, nullptr, 0, 0, 0);
-          max_idx_ = n_lines_;
-          break;
-        default:
-          img_ = cv::Mat::zeros(cv::Size(n_samples_, n_lines_),
-                                cv::DataType<T>::type);
-          err = dataset_->GetRasterBand(cur_ + 1)->RasterIO(
-              GF_Read, 0, 0, n_samples_, n_lines_, img_.data, n_samples_,
-              n_lines_, gdal::DataType<T>::type(), 0, 0);
-          max_idx_ = n_bands_;
-      }
+      const int max_table[] = {n_samples_, n_lines_, n_bands_};
+      max_idx_ = max_table[std::min(N, 3u) - 1];
+      read_slice_(dataset_, n_samples_, n_lines_, n_bands_, cur_, img_);
+    }
+  }
+
+  /**
+   * @brief 用于构造启用异步预取的输入迭代器。
+   *
+   * @note 构造时，会同步读取cur指向的数据，并开始在后台预取之后的数据。
+   *
+   * @param dataset 数据集指针
+   * @param cur 迭代开始位置，从0开始计数
+   * @param prefetch 预取的切片数，不大于0时不启用预取
+   * @param advise_read 每次通过AdviseRead()提示驱动的切片数，不大于0时不提示；
+   * 提示总是领先读取位置一个窗口
+   */
+  InputIterator_(GDALDataset* dataset, int cur, int prefetch,
+                 int advise_read = 0)
+      : InputIterator_(dataset, cur) {
+    advise_ = std::max(advise_read, 0);
+    advise_start_ = cur_ + 1;
+    if (dataset && advise_ > 0) {
+      gdal::AdviseSlices(dataset, N, advise_start_, advise_);
+    }
+    if (dataset && prefetch > 0 && cur_ + 1 < max_idx_) {
+      const int n_samples = n_samples_, n_lines = n_lines_, n_bands = n_bands_;
+      const int advise = advise_, advise_start = advise_start_;
+      prefetcher_ = std::make_shared<Prefetcher<cv::Mat>>(
+          cur_ + 1, max_idx_, prefetch, [=](int idx) {
+            // the dataset is only touched by the prefetching thread
+            advise_ahead_(dataset, advise, advise_start, idx);
+            cv::Mat img;
+            read_slice_(dataset, n_samples, n_lines, n_bands, idx, img);
+            return img;
+          });
     }
   }
 
+  /**
+   * @brief 按读写参数构造输入迭代器，使用其中的预取深度和AdviseRead窗口。
+   *
+   * @param dataset 数据集指针
+   * @param cur 迭代开始位置，从0开始计数
+   * @param config 读写参数
+   */
+  InputIterator_(GDALDataset* dataset, int cur, const gdal::IOConfig& config)
+      : InputIterator_(dataset, cur, config.prefetch, config.advise_read) {}
+
  private:
   GDALDataset* dataset_;
   int n_samples_{0};
@@ -127,12 +163,23 @@ class InputIterator_
   int cur_{0};
   int max_idx_{0};
   cv::Mat img_;
+  std::shared_ptr<Prefetcher<cv::Mat>> prefetcher_;
+  int advise_{0};
+  int advise_start_{0};
+
+  template <typename, unsigned>
+  friend class RandomAccessInputIterator_;
 
  private:
   bool equal(InputIterator_ const& other) const { return cur_ == other.cur_; }
   void increment() {
     if (cur_ + 1 < max_idx_) {
-      read_data_(cur_ + 1);  // read in advance
+      if (prefetcher_) {
+        img_ = prefetcher_->pop();
+      } else {
+        advise_ahead_(dataset_, advise_, advise_start_, cur_ + 1);
+        read_data_(cur_ + 1);  // read in advance
+      }
     }
     ++cur_;
   }
@@ -140,27 +187,55 @@ class InputIterator_
 
   void read_data_(int idx) {
     if (idx < max_idx_ && idx > 0) {
-      CPLErr err;
-      switch (N) {
-        case 1:
-          err = dataset_->RasterIO(GF_Read, idx, 0, 1, n_lines_, img_.data, 1,
-                                   n_lines_, gdal::DataType<T>::type(),
-                                   n_bands_, nullptr, 0, 0, 0);
-          break;
-        case 2:
-          err = dataset_->RasterIO(GF_Read, 0, idx, n_samples_, 1, img_.data,
-                                   n_samples_, 1, gdal::DataType<T>::type(),
-                                   n_bands_, nullptr, 0, 0, 0);
-          break;
-        default:
-          err = dataset_->GetRasterBand(idx + 1)->RasterIO(
-              GF_Read, 0, 0, n_samples_, n_lines_, img_.data, n_samples_,
-              n_lines_, gdal::DataType<T>::type(), 0, 0);
-      }
+      read_slice_(dataset_, n_samples_, n_lines_, n_bands_, idx, img_);
     } else {
       throw std::out_of_range("Input iterator out of range.");
     }
   }
+
+  /**
+   * @brief 读取位置idx到达一个窗口的开头时，提示驱动下一个窗口。
+   *
+   */
+  static void advise_ahead_(GDALDataset* dataset, int advise, int start,
+                            int idx) {
+    if (advise > 0 && (idx - start) % advise == 0) {
+      gdal::AdviseSlices(dataset, N, idx + advise, advise);
+    }
+  }
+
+  /**
+   * @brief 读取第idx个切片到img，img尺寸或类型不符时重新分配。
+   *
+   * @note 读取失败时抛出std::runtime_error，预读取时在取到该切片时重新抛出。
+   */
+  static void read_slice_(GDALDataset* dataset, int n_samples, int n_lines,
+                          int n_bands, int idx, cv::Mat& img) {
+    CPLErr err;
+    switch (N) {
+      case 1:
+        img.create(cv::Size(n_lines, n_bands), cv::DataType<T>::type);
+        err = dataset->RasterIO(GF_Read, idx, 0, 1, n_lines, img.data, 1,
+                                n_lines, gdal::DataType<T>::type(), n_bands,
+                                nullptr, 0, 0, 0);
+        break;
+      case 2:
+        img.create(cv::Size(n_samples, n_bands), cv::DataType<T>::type);
+        err = dataset->RasterIO(GF_Read, 0, idx, n_samples, 1, img.data,
+                                n_samples, 1, gdal::DataType<T>::type(),
+                                n_bands, nullptr, 0, 0, 0);
+        break;
+      default:
+        img.create(cv::Size(n_samples, n_lines), cv::DataType<T>::type);
+        err = dataset->GetRasterBand(idx + 1)->RasterIO(
+            GF_Read, 0, 0, n_samples, n_lines, img.data, n_samples, n_lines,
+            gdal::DataType<T>::type(), 0, 0);
+    }
+    if (err == CE_Failure) {
+      throw std::runtime_error(std::string("GDAL read failed: ") +
+                               CPLGetLastErrorMsg());
+    }
+  }
 };
 
 /**
@@ -199,6 +274,166 @@ using LineInputIterator = InputIterator_<T, 2>;
 template <typename T>
 using BandInputIterator = InputIterator_<T, 3>;
 
+/**
+ * @brief 随机访问输入迭代器，用于特化为其他迭代器。
+ *
+ * @tparam T 读取影像像元的数据类型
+ * @tparam N 特化迭代器类型，1为样本迭代器，2为行迭代器，3为波段迭代器
+ *
+ * @details
+ * 与InputIterator_不同，构造和移动迭代器时不读取数据，解引用时才读取当前切片，
+ * 每次解引用返回独立的cv::Mat。因此迭代器可以任意前后移动、求距离、比较大小，
+ * 也可以把一个范围切分给多个线程。
+ *
+ * 解引用按值返回，所以只有boost的遍历类别（boost::iterator_traversal）是随机访问，
+ * std::iterator_traits的iterator_category只能是输入迭代器。按iterator_category
+ * 分派的标准算法（如std::distance）会逐个移动，需要跳转时直接使用迭代器的运算符。
+ *
+ * 默认构造的迭代器不指向数据集，只能用于赋值，解引用时抛出std::runtime_error。
+ *
+ * 迭代器只保存数据集指针和位置。GDAL的数据集句柄不是线程安全的，
+ * 多线程使用时每个线程应使用自己的数据集句柄，见parallel_partition()。
+ *
+ * 本迭代器类通过指定类型，特化为RandomSampleInputIterator、RandomLineInputIterator和RandomBandInputIterator。
+ */
+template <typename T, unsigned N>
+class RandomAccessInputIterator_
+    : public boost::iterator_facade<RandomAccessInputIterator_<T, N>,
+                                    cv::Mat const,
+                                    boost::random_access_traversal_tag,
+                                    cv::Mat> {
+  friend boost::iterator_core_access;
+
+ public:
+  RandomAccessInputIterator_() = default;
+
+  /**
+   * @brief 构造函数。
+   *
+   * @param dataset 数据集指针
+   * @param cur 当前位置，从0开始计数；末端迭代器为样本/行/波段数
+   */
+  RandomAccessInputIterator_(GDALDataset* dataset, int cur)
+      : dataset_{dataset}, cur_{cur} {}
+
+  /**
+   * @brief 数据集指针。
+   *
+   * @return GDALDataset*
+   */
+  GDALDataset* dataset() const { return dataset_; }
+
+  /**
+   * @brief 当前位置，从0开始计数。
+   *
+   * @return int
+   */
+  int index() const { return cur_; }
+
+ private:
+  GDALDataset* dataset_{nullptr};
+  int cur_{0};
+
+ private:
+  cv::Mat dereference() const {
+    if (!dataset_) {
+      throw std::runtime_error("Dereference iterator without dataset!");
+    }
+    const int n_samples = dataset_->GetRasterXSize();
+    const int n_lines = dataset_->GetRasterYSize();
+    const int n_bands = dataset_->GetRasterCount();
+    const int max_table[] = {n_samples, n_lines, n_bands};
+    if (cur_ < 0 || cur_ >= max_table[std::min(N, 3u) - 1]) {
+      throw std::out_of_range("Input iterator out of range.");
+    }
+    cv::Mat img;
+    InputIterator_<T, N>::read_slice_(dataset_, n_samples, n_lines, n_bands,
+                                      cur_, img);
+    return img;
+  }
+  bool equal(RandomAccessInputIterator_ const& other) const {
+    return cur_ == other.cur_;
+  }
+  void increment() { ++cur_; }
+  void decrement() { --cur_; }
+  void advance(std::ptrdiff_t n) { cur_ += static_cast<int>(n); }
+  std::ptrdiff_t distance_to(RandomAccessInputIterator_ const& other) const {
+    return other.cur_ - cur_;
+  }
+};
+
+/**
+ * @brief 随机访问样本输入迭代器。
+ *
+ * @tparam T 读取影像的数据类型
+ * @details 见RandomAccessInputIterator_。
+ */
+template <typename T>
+using RandomSampleInputIterator = RandomAccessInputIterator_<T, 1>;
+
+/**
+ * @brief 随机访问行输入迭代器。
+ *
+ * @tparam T 读取影像的数据类型
+ * @details
+ * \code{.cpp}
+ * hsp::RandomLineInputIterator<float> beg(src_dataset, 0),
+ *     end(src_dataset, src_dataset->GetRasterYSize());
+ * cv::Mat last = *(end - 1);
+ * auto mid = beg + (end - beg) / 2;
+ * \endcode
+ */
+template <typename T>
+using RandomLineInputIterator = RandomAccessInputIterator_<T, 2>;
+
+/**
+ * @brief 随机访问波段输入迭代器。
+ *
+ * @tparam T 读取影像的数据类型
+ * @details 见RandomAccessInputIterator_。
+ */
+template <typename T>
+using RandomBandInputIterator = RandomAccessInputIterator_<T, 3>;
+
+/**
+ * @brief 以数据集自身的像元类型构造一对输入迭代器（起始和末端），并调用f。
+ *
+ * @tparam N 迭代器类型，1为样本迭代器，2为行迭代器，3为波段迭代器
+ * @tparam F 可调用对象，通常为泛型lambda，以(begin, end)调用
+ *
+ * @details
+ * InputIterator_<T, N>总是让GDAL把像元转换为T，之后的处理往往又转换一次。
+ * 本函数在运行期读取第一个波段的GDALDataType，只分派一次，
+ * 以InputIterator_<原始类型, N>调用f：读取时GDAL不做类型转换，
+ * f内部可以通过pixel_type按原始类型实例化后续的处理。
+ *
+ * @code{.cpp}
+ *  hsp::with_native_iterators<2>(src_dataset, [&](auto beg, auto end) {
+ *    using T = typename decltype(beg)::pixel_type;
+ *    hsp::LineOutputIterator<T> out(dst_dataset, 0);
+ *    std::copy(beg, end, out);
+ *  });
+ * @endcode
+ *
+ * @param dataset 数据集指针
+ * @param f 处理一对迭代器的可调用对象
+ * @return f的返回值
+ */
+template <unsigned N, typename F>
+auto with_native_iterators(GDALDataset* dataset, F&& f)
+    -> decltype(f(InputIterator_<unsigned char, N>(dataset, 0),
+                  InputIterator_<unsigned char, N>(dataset))) {
+  if (!dataset || dataset->GetRasterCount() == 0) {
+    throw std::runtime_error("Dataset has no raster band!");
+  }
+  return gdal::visit_data_type(
+      dataset->GetRasterBand(1)->GetRasterDataType(), [&](auto tag) {
+        using T = typename decltype(tag)::type;
+        return f(InputIterator_<T, N>(dataset, 0),
+                 InputIterator_<T, N>(dataset));
+      });
+}
+
 /**
  * @brief 输出迭代器，用于特化为其他迭代器。
  *
@@ -213,6 +448,19 @@ using BandInputIterator = InputIterator_<T, 3>;
  *
  * 在实例化时，如果指定了当前的样本/行/波段号（均从0开始计数），那么实例化为普通的迭代器。如果不指定，那么该实例为末端迭代器，仅用于表示数据集的末尾。
  *
+ * 默认情况下，赋值时同步写入，写入失败时抛出std::runtime_error。
+ * 构造时指定队列深度后启用异步写入（write-behind）：赋值只把数据复制到批次缓冲区，
+ * 连续的样本/行/波段合并为一个批次，由专门的写线程以一次RasterIO写入；队列满时赋值等待。
+ * 写入错误在之后的赋值、flush()或close()中以std::runtime_error抛出。
+ * 迭代器的各个副本共享同一个写线程，最后一个副本销毁时写完剩余数据，但不再报告错误，
+ * 因此需要确认写入结果时应显式调用close()。异步写入期间，其他线程不应同时读写同一个数据集。
+ *
+ * \code{.cpp}
+ * hsp::LineOutputIterator<uint16_t> out(dst_dataset, 0, 8);
+ * out = std::transform(beg, end, out, ops);
+ * out.close();
+ * \endcode
+ *
  * 本迭代器类通过指定类型，特化为SampleOutputIterator、LineOutputIterator和BandOutputIterator。
  */
 template <typename T, unsigned N>
@@ -240,6 +488,64 @@ class OutputIterator_
     init_();
   }
 
+  /**
+   * @brief 初始化为异步写入的输出迭代器。
+   *
+   * @param dataset 数据集指针
+   * @param cur 当前位置，从0开始计数
+   * @param queue_depth 写队列中最多等待的批次数，不大于0时为同步写入
+   * @param batch 每批次最多合并的样本/行数；波段迭代器每批次只有一个波段
+   */
+  OutputIterator_(GDALDataset* dataset, int cur, int queue_depth,
+                  int batch = 16)
+      : OutputIterator_(dataset, cur) {
+    if (queue_depth > 0) {
+      writer_ = std::make_shared<Writer_>(dataset_, queue_depth,
+                                          N == 3 ? 1 : std::max(batch, 1));
+    }
+  }
+
+  /**
+   * @brief 按读写参数初始化输出迭代器，使用其中的异步写入队列深度。
+   *
+   * @param dataset 数据集指针
+   * @param cur 当前位置，从0开始计数
+   * @param config 读写参数
+   */
+  OutputIterator_(GDALDataset* dataset, int cur, const gdal::IOConfig& config)
+      : OutputIterator_(dataset, cur, config.write_queue) {}
+
+  /**
+   * @brief 等待已赋值的数据全部写入数据集，并刷新数据集缓存。
+   *
+   * @note 写入失败时抛出std::runtime_error。
+   */
+  void flush() {
+    if (writer_) {
+      writer_->flush();
+      return;
+    }
+    CPLErrorReset();
+    dataset_->FlushCache();
+    if (CPLGetLastErrorType() == CE_Failure) {
+      throw std::runtime_error(std::string("GDAL flush failed: ") +
+                               CPLGetLastErrorMsg());
+    }
+  }
+
+  /**
+   * @brief 写入全部数据，并停止写线程。之后不能再赋值。
+   *
+   * @note 写入失败时抛出std::runtime_error。
+   */
+  void close() {
+    if (writer_) {
+      writer_->close();
+      return;
+    }
+    flush();
+  }
+
   /**
    * @brief 重载赋值符号。
    *
@@ -249,22 +555,34 @@ class OutputIterator_
    * @note 数据写入操作在此处进行。
    */
   OutputIterator_& operator=(const cv::Mat& value) {
+    if (writer_) {
+      writer_->put(cur_, value);
+      return *this;
+    }
     CPLErr err;
+    // value may be a non-continuous view (e.g. frames of mapped raw data),
+    // so the row step is passed to GDAL instead of assuming a packed buffer
+    const GSpacing elem_size = value.elemSize();
+    const GSpacing row_step = value.step[0];
     switch (N) {
       case 1:
         err = dataset_->RasterIO(GF_Write, cur_, 0, 1, n_lines_, value.data, 1,
                                  n_lines_, gdal::DataType<T>::type(), n_bands_,
-                                 nullptr, 0, 0, 0);
+                                 nullptr, elem_size, elem_size, row_step);
         break;
       case 2:
         err = dataset_->RasterIO(GF_Write, 0, cur_, n_samples_, 1, value.data,
                                  n_samples_, 1, gdal::DataType<T>::type(),
-                                 n_bands_, nullptr, 0, 0, 0);
+                                 n_bands_, nullptr, elem_size, 0, row_step);
         break;
       default:
         err = dataset_->GetRasterBand(cur_ + 1)->RasterIO(
             GF_Write, 0, 0, n_samples_, n_lines_, value.data, n_samples_,
-            n_lines_, gdal::DataType<T>::type(), 0, 0);
+            n_lines_, gdal::DataType<T>::type(), elem_size, row_step);
+    }
+    if (err == CE_Failure) {
+      throw std::runtime_error(std::string("GDAL write failed: ") +
+                               CPLGetLastErrorMsg());
     }
     return *this;
   }
@@ -316,11 +634,176 @@ class OutputIterator_
   OutputIterator_& operator*() { return *this; }
 
  private:
+  /**
+   * @brief 异步写入的批次缓冲区和写线程。
+   *
+   * @details
+   * 批次缓冲区把count个切片（样本为 bands * lines，行为 bands * samples，波段为
+   * lines * samples）纵向堆叠，按切片类型设置RasterIO的像元、行、波段间距，一次写入。
+   */
+  class Writer_ {
+   public:
+    Writer_(GDALDataset* dataset, int queue_depth, int batch)
+        : dataset_{dataset}, batch_size_{batch}, ring_(queue_depth) {
+      worker_ = std::thread([this] { run_(); });
+    }
+
+    Writer_(const Writer_&) = delete;
+    Writer_& operator=(const Writer_&) = delete;
+
+    ~Writer_() {
+      try {
+        submit_();
+      } catch (...) {
+      }
+      stop_ = true;
+      if (worker_.joinable()) {
+        worker_.join();
+      }
+    }
+
+    void put(int idx, const cv::Mat& value) {
+      check_();
+      if (closed_) {
+        throw std::logic_error("OutputIterator is closed");
+      }
+      if (value.type() != cv::DataType<T>::type) {
+        throw std::invalid_argument("data type mismatch");
+      }
+      if (!batch_.data.empty() &&
+          (idx != batch_.first + batch_.count ||
+           batch_.count == batch_size_ || value.size() != slice_size_)) {
+        submit_();
+      }
+      if (batch_.data.empty()) {
+        slice_size_ = value.size();
+        batch_.data.create(slice_size_.height * batch_size_, slice_size_.width,
+                           cv::DataType<T>::type);
+        batch_.first = idx;
+        batch_.count = 0;
+      }
+      const int rows = slice_size_.height;
+      cv::Mat dst = batch_.data.rowRange(batch_.count * rows,
+                                         (batch_.count + 1) * rows);
+      value.copyTo(dst);
+      ++batch_.count;
+    }
+
+    void flush() {
+      submit_();
+      Backoff backoff;
+      while (written_.load(std::memory_order_acquire) < submitted_) {
+        backoff();
+      }
+      check_();
+      CPLErrorReset();
+      dataset_->FlushCache();
+      if (CPLGetLastErrorType() == CE_Failure) {
+        throw std::runtime_error(std::string("GDAL flush failed: ") +
+                                 CPLGetLastErrorMsg());
+      }
+    }
+
+    void close() {
+      if (closed_) {
+        check_();
+        return;
+      }
+      closed_ = true;
+      flush();
+    }
+
+   private:
+    struct Batch {
+      int first{0};
+      int count{0};
+      cv::Mat data;
+    };
+
+    GDALDataset* dataset_;
+    const int batch_size_;
+    Batch batch_;
+    cv::Size slice_size_;
+    long submitted_{0};
+    bool closed_{false};
+    SPSCRing<Batch> ring_;
+    std::atomic<long> written_{0};
+    std::atomic<bool> failed_{false};
+    std::string error_;
+    std::atomic<bool> stop_{false};
+    std::thread worker_;
+
+   private:
+    void check_() const {
+      if (failed_.load(std::memory_order_acquire)) {
+        throw std::runtime_error(error_);
+      }
+    }
+
+    void submit_() {
+      if (batch_.data.empty()) {
+        return;
+      }
+      ring_.push(std::move(batch_));
+      batch_ = Batch();
+      ++submitted_;
+    }
+
+    void run_() {
+      Backoff backoff;
+      for (;;) {
+        Batch batch;
+        if (!ring_.try_pop(batch)) {
+          if (stop_) {
+            return;
+          }
+          backoff();
+          continue;
+        }
+        backoff = Backoff();
+        // after a failure the rest is drained, so the producer never blocks
+        if (!failed_.load(std::memory_order_relaxed) &&
+            write_(batch) == CE_Failure) {
+          error_ = std::string("GDAL write failed: ") + CPLGetLastErrorMsg();
+          failed_.store(true, std::memory_order_release);
+        }
+        written_.fetch_add(1, std::memory_order_release);
+      }
+    }
+
+    CPLErr write_(const Batch& batch) const {
+      const int n_samples = dataset_->GetRasterXSize();
+      const int n_lines = dataset_->GetRasterYSize();
+      const int n_bands = dataset_->GetRasterCount();
+      const GSpacing elem = sizeof(T);
+      const GSpacing step = batch.data.step[0];
+      const GSpacing slice = step * slice_size_.height;
+      switch (N) {
+        case 1:
+          return dataset_->RasterIO(GF_Write, batch.first, 0, batch.count,
+                                    n_lines, batch.data.data, batch.count,
+                                    n_lines, gdal::DataType<T>::type(),
+                                    n_bands, nullptr, slice, elem, step);
+        case 2:
+          return dataset_->RasterIO(GF_Write, 0, batch.first, n_samples,
+                                    batch.count, batch.data.data, n_samples,
+                                    batch.count, gdal::DataType<T>::type(),
+                                    n_bands, nullptr, elem, slice, step);
+        default:
+          return dataset_->GetRasterBand(batch.first + 1)
+              ->RasterIO(GF_Write, 0, 0, n_samples, n_lines, batch.data.data,
+                         n_samples, n_lines, gdal::DataType<T>::type(), elem,
+                         step);
+      }
+    }
+  };
+
   GDALDataset* dataset_;
   int n_samples_{0};
   int n_lines_{0};
   int n_bands_{0};
   int cur_{0};
+  std::shared_ptr<Writer_> writer_;
 
  private:
   void init_() {
@@ -368,6 +851,503 @@ using LineOutputIterator = OutputIterator_<T, 2>;
 template <typename T>
 using BandOutputIterator = OutputIterator_<T, 3>;
 
+/**
+ * @brief 按GDALDataset自然分块（GetBlockSize()）划分的分块网格。
+ *
+ */
+class TileGrid {
+ public:
+  TileGrid() = default;
+
+  /**
+   * @brief 构造函数。
+   *
+   * @param dataset 数据集指针
+   * @param tile_size 分块尺寸，宽或高不大于0时采用第1波段的GetBlockSize()
+   */
+  TileGrid(GDALDataset* dataset, cv::Size tile_size) {
+    if (!dataset) {
+      throw std::runtime_error("Initialize TileGrid with nullptr!");
+    }
+    n_samples_ = dataset->GetRasterXSize();
+    n_lines_ = dataset->GetRasterYSize();
+    n_bands_ = dataset->GetRasterCount();
+    if (tile_size.width <= 0 || tile_size.height <= 0) {
+      dataset->GetRasterBand(1)->GetBlockSize(&tile_size.width,
+                                              &tile_size.height);
+    }
+    tile_size_ = tile_size;
+    tiles_x_ = (n_samples_ + tile_size_.width - 1) / tile_size_.width;
+    tiles_y_ = (n_lines_ + tile_size_.height - 1) / tile_size_.height;
+  }
+
+  /** @brief 分块总数。 */
+  int size() const { return tiles_x_ * tiles_y_; }
+
+  /** @brief 分块尺寸。 */
+  cv::Size tile_size() const { return tile_size_; }
+
+  /** @brief 波段数。 */
+  int bands() const { return n_bands_; }
+
+  /**
+   * @brief 第i个分块在影像中的范围。分块按行优先顺序编号，右侧和下侧边缘的分块可能较小。
+   *
+   * @param i 分块序号，从0开始计数
+   * @return cv::Rect
+   */
+  cv::Rect rect(int i) const {
+    const int x = (i % tiles_x_) * tile_size_.width;
+    const int y = (i / tiles_x_) * tile_size_.height;
+    return cv::Rect(x, y, std::min(tile_size_.width, n_samples_ - x),
+                    std::min(tile_size_.height, n_lines_ - y));
+  }
+
+  /**
+   * @brief 读写第i个分块的全部波段。
+   *
+   * @details
+   * 分块在内存中为 rows * bands * cols 的三维矩阵（按行交织），其中每个
+   * cv::Mat(bands, cols, type, block.ptr(r)) 都是一行，可以直接交给按行处理的算法。
+   * 一次RasterIO读写整个分块，底层文件的每个块只被访问一次。
+   *
+   * @tparam T 像元数据类型
+   * @param rw 读或写
+   * @param dataset 数据集指针
+   * @param i 分块序号
+   * @param block 三维矩阵，读取时按需分配
+   * @return CPLErr
+   */
+  template <typename T>
+  CPLErr io(GDALRWFlag rw, GDALDataset* dataset, int i, cv::Mat& block) const {
+    const cv::Rect r = rect(i);
+    if (rw == GF_Read) {
+      const int sizes[] = {r.height, n_bands_, r.width};
+      block.create(3, sizes, cv::DataType<T>::type);
+    }
+    return dataset->RasterIO(rw, r.x, r.y, r.width, r.height, block.data,
+                             r.width, r.height, gdal::DataType<T>::type(),
+                             n_bands_, nullptr, sizeof(T), block.step[0],
+                             block.step[1]);
+  }
+
+ private:
+  int n_samples_{0};
+  int n_lines_{0};
+  int n_bands_{0};
+  int tiles_x_{0};
+  int tiles_y_{0};
+  cv::Size tile_size_;
+};
+
+/**
+ * @brief 分块输入迭代器，按数据集的自然分块逐块读取全部波段。
+ *
+ * @tparam T 读取影像像元的数据类型
+ *
+ * @details
+ * 分块尺寸默认与第1波段的GetBlockSize()一致：分块存储（tiled）的GeoTIFF按瓦片迭代，
+ * 条带存储的文件按条带迭代。每个分块以一次RasterIO读取全部波段，
+ * 无论文件按波段、按行还是按像元交织，底层的每个块都只读取一次，
+ * 避免LineInputIterator在按波段交织的文件上每行访问n_bands个块。
+ *
+ * 迭代器的值类型为 rows * bands * cols 的三维cv::Mat（见TileGrid::io()），
+ * 当前分块在影像中的范围由rect()给出。与TileOutputIterator配合使用时，两者的分块尺寸必须一致。
+ *
+ * \code{.cpp}
+ * hsp::TileInputIterator<uint16_t> it(src_dataset, 0), end(src_dataset);
+ * hsp::TileOutputIterator<uint16_t> out(dst_dataset, 0, it.tile_size());
+ * std::copy(it, end, out);
+ * \endcode
+ */
+template <typename T>
+class TileInputIterator
+    : public boost::iterator_facade<TileInputIterator<T>, cv::Mat const,
+                                    boost::single_pass_traversal_tag> {
+  friend boost::iterator_core_access;
+
+ public:
+  using reference = cv::Mat const&;
+
+  /**
+   * @brief 仅用于构造末端迭代器，用于表示数据集的末尾
+   *
+   * @param dataset 数据集指针
+   * @param tile_size 分块尺寸，默认为数据集的自然分块尺寸
+   */
+  explicit TileInputIterator(GDALDataset* dataset,
+                             cv::Size tile_size = cv::Size())
+      : dataset_{dataset}, grid_(dataset, tile_size), cur_{grid_.size()} {}
+
+  /**
+   * @brief 用于构造输入迭代器。
+   *
+   * @note 构造时，会预读取cur指向的分块。
+   *
+   * @param dataset 数据集指针
+   * @param cur 迭代开始的分块序号，从0开始计数
+   * @param tile_size 分块尺寸，默认为数据集的自然分块尺寸
+   */
+  TileInputIterator(GDALDataset* dataset, int cur,
+                    cv::Size tile_size = cv::Size())
+      : dataset_{dataset}, grid_(dataset, tile_size), cur_{cur} {
+    if (cur_ < grid_.size()) {
+      read_data_(cur_);
+    }
+  }
+
+  /** @brief 分块尺寸。 */
+  cv::Size tile_size() const { return grid_.tile_size(); }
+
+  /** @brief 当前分块在影像中的范围。 */
+  cv::Rect rect() const { return grid_.rect(cur_); }
+
+ private:
+  GDALDataset* dataset_;
+  TileGrid grid_;
+  int cur_{0};
+  cv::Mat img_;
+
+ private:
+  bool equal(TileInputIterator const& other) const {
+    return cur_ == other.cur_;
+  }
+  void increment() {
+    if (cur_ + 1 < grid_.size()) {
+      read_data_(cur_ + 1);  // read in advance
+    }
+    ++cur_;
+  }
+  reference dereference() const { return img_; }
+
+  void read_data_(int idx) {
+    if (idx < 0 || idx >= grid_.size()) {
+      throw std::out_of_range("Input iterator out of range.");
+    }
+    if (grid_.io<T>(GF_Read, dataset_, idx, img_) == CE_Failure) {
+      throw std::runtime_error(std::string("GDAL read failed: ") +
+                               CPLGetLastErrorMsg());
+    }
+  }
+};
+
+/**
+ * @brief 分块输出迭代器，按数据集的自然分块逐块写入全部波段。
+ *
+ * @tparam T 写入影像的像元数据类型
+ *
+ * @details 写入的值须为TileInputIterator给出的 rows * bands * cols 三维矩阵。见TileInputIterator。
+ */
+template <typename T>
+class TileOutputIterator
+    : public std::iterator<std::output_iterator_tag, void, void, void, void> {
+ public:
+  /**
+   * @brief 初始化为末端迭代器。
+   *
+   * @param dataset 数据集指针
+   * @param tile_size 分块尺寸，默认为数据集的自然分块尺寸
+   */
+  explicit TileOutputIterator(GDALDataset* dataset,
+                              cv::Size tile_size = cv::Size())
+      : dataset_{dataset}, grid_(dataset, tile_size), cur_{grid_.size()} {}
+
+  /**
+   * @brief 初始化为普通输出迭代器。
+   *
+   * @param dataset 数据集指针
+   * @param cur 当前分块序号，从0开始计数
+   * @param tile_size 分块尺寸，默认为数据集的自然分块尺寸
+   */
+  TileOutputIterator(GDALDataset* dataset, int cur,
+                     cv::Size tile_size = cv::Size())
+      : dataset_{dataset}, grid_(dataset, tile_size), cur_{cur} {}
+
+  /**
+   * @brief 重载赋值符号。
+   *
+   * @param value 当前分块，rows * bands * cols 的三维矩阵
+   * @return TileOutputIterator& 返回*this
+   *
+   * @note 数据写入操作在此处进行。尺寸或类型不符时抛出std::invalid_argument，
+   * 写入失败时抛出std::runtime_error。
+   */
+  TileOutputIterator& operator=(const cv::Mat& value) {
+    const cv::Rect r = grid_.rect(cur_);
+    if (value.dims != 3 || value.size[0] != r.height ||
+        value.size[1] != grid_.bands() || value.size[2] != r.width) {
+      throw std::invalid_argument("tile size mismatch");
+    }
+    if (value.type() != cv::DataType<T>::type) {
+      throw std::invalid_argument("data type mismatch");
+    }
+    cv::Mat block = value;
+    if (grid_.io<T>(GF_Write, dataset_, cur_, block) == CE_Failure) {
+      throw std::runtime_error(std::string("GDAL write failed: ") +
+                               CPLGetLastErrorMsg());
+    }
+    return *this;
+  }
+
+  /**
+   * @brief 前缀自增。
+   *
+   * @return TileOutputIterator&
+   */
+  TileOutputIterator& operator++() {
+    ++cur_;
+    return *this;
+  }
+  /**
+   * @brief 后缀自增。
+   *
+   * @return TileOutputIterator
+   */
+  TileOutputIterator operator++(int) {
+    TileOutputIterator old(*this);
+    ++(*this);
+    return old;
+  }
+  bool operator==(const TileOutputIterator& other) const {
+    return cur_ == other.cur_;
+  }
+  bool operator!=(const TileOutputIterator& other) const {
+    return !(*this == other);
+  }
+  /**
+   * @brief 迭代器解引用。
+   *
+   * @return TileOutputIterator& 返回*this
+   */
+  TileOutputIterator& operator*() { return *this; }
+
+  /** @brief 当前分块在影像中的范围。 */
+  cv::Rect rect() const { return grid_.rect(cur_); }
+
+ private:
+  GDALDataset* dataset_;
+  TileGrid grid_;
+  int cur_{0};
+};
+
+/**
+ * @brief 多行块输入迭代器，每步读取连续K行。
+ *
+ * @tparam T 读取影像像元的数据类型
+ *
+ * @details
+ * 每步以一次RasterIO读取连续K行的全部波段（最后一块可能不足K行），
+ * 值为把K个 bands * samples 的行图像纵向堆叠而成的 (K * bands) * samples 矩阵，
+ * 第k行为 rowRange(k * bands, (k + 1) * bands)。与LineInputIterator相比，
+ * GDAL读写和算法调用的开销分摊到K行上。
+ *
+ * 暗电平扣除、非均匀校正等逐行系数的算法可以直接处理多行块；
+ * 其余只能处理单行的算法可用per_line()适配后放入UnaryOpCombo。
+ *
+ * \code{.cpp}
+ * const int K = 64;
+ * hsp::ChunkInputIterator<uint16_t> it(src_dataset, 0, K), end(src_dataset, K);
+ * hsp::ChunkOutputIterator<uint16_t> out(dst_dataset, 0, K);
+ * std::transform(it, end, out, ops);
+ * \endcode
+ */
+template <typename T>
+class ChunkInputIterator
+    : public boost::iterator_facade<ChunkInputIterator<T>, cv::Mat const,
+                                    boost::single_pass_traversal_tag> {
+  friend boost::iterator_core_access;
+
+ public:
+  using reference = cv::Mat const&;
+
+  /**
+   * @brief 仅用于构造末端迭代器，用于表示数据集的末尾
+   *
+   * @param dataset 数据集指针
+   * @param lines_per_chunk 每块的行数K
+   */
+  ChunkInputIterator(GDALDataset* dataset, int lines_per_chunk)
+      : dataset_{dataset},
+        grid_(dataset, chunk_size_(dataset, lines_per_chunk)),
+        cur_{grid_.size()} {}
+
+  /**
+   * @brief 用于构造输入迭代器。
+   *
+   * @note 构造时，会预读取cur指向的块。
+   *
+   * @param dataset 数据集指针
+   * @param cur 迭代开始的块序号，从0开始计数，第cur块从第 cur * K 行开始
+   * @param lines_per_chunk 每块的行数K
+   */
+  ChunkInputIterator(GDALDataset* dataset, int cur, int lines_per_chunk)
+      : dataset_{dataset},
+        grid_(dataset, chunk_size_(dataset, lines_per_chunk)),
+        cur_{cur} {
+    if (cur_ < grid_.size()) {
+      read_data_(cur_);
+    }
+  }
+
+  /** @brief 当前块的起始行号。 */
+  int first_line() const { return grid_.rect(cur_).y; }
+
+ private:
+  GDALDataset* dataset_;
+  TileGrid grid_;
+  int cur_{0};
+  cv::Mat block_;
+  cv::Mat img_;
+
+ private:
+  static cv::Size chunk_size_(GDALDataset* dataset, int lines_per_chunk) {
+    if (!dataset || lines_per_chunk <= 0) {
+      throw std::invalid_argument("invalid chunk iterator");
+    }
+    return cv::Size(dataset->GetRasterXSize(), lines_per_chunk);
+  }
+
+  bool equal(ChunkInputIterator const& other) const {
+    return cur_ == other.cur_;
+  }
+  void increment() {
+    if (cur_ + 1 < grid_.size()) {
+      read_data_(cur_ + 1);  // read in advance
+    }
+    ++cur_;
+  }
+  reference dereference() const { return img_; }
+
+  void read_data_(int idx) {
+    if (idx < 0 || idx >= grid_.size()) {
+      throw std::out_of_range("Input iterator out of range.");
+    }
+    if (grid_.io<T>(GF_Read, dataset_, idx, block_) == CE_Failure) {
+      throw std::runtime_error(std::string("GDAL read failed: ") +
+                               CPLGetLastErrorMsg());
+    }
+    // lines x bands x samples, viewed as stacked line images; the view
+    // shares the refcount of block_, so copies stay valid after the last,
+    // shorter chunk reallocates it
+    img_ = block_.reshape(0, block_.size[0] * block_.size[1]);
+  }
+};
+
+/**
+ * @brief 多行块输出迭代器，每步写入连续K行。
+ *
+ * @tparam T 写入影像的像元数据类型
+ *
+ * @details 写入的值为 (k * bands) * samples 的矩阵，k不超过K。见ChunkInputIterator。
+ */
+template <typename T>
+class ChunkOutputIterator
+    : public std::iterator<std::output_iterator_tag, void, void, void, void> {
+ public:
+  /**
+   * @brief 初始化为末端迭代器。
+   *
+   * @param dataset 数据集指针
+   * @param lines_per_chunk 每块的行数K
+   */
+  ChunkOutputIterator(GDALDataset* dataset, int lines_per_chunk)
+      : ChunkOutputIterator(dataset, 0, lines_per_chunk) {
+    cur_ = (n_lines_ + lines_per_chunk_ - 1) / lines_per_chunk_;
+  }
+
+  /**
+   * @brief 初始化为普通输出迭代器。
+   *
+   * @param dataset 数据集指针
+   * @param cur 当前块序号，从0开始计数
+   * @param lines_per_chunk 每块的行数K
+   */
+  ChunkOutputIterator(GDALDataset* dataset, int cur, int lines_per_chunk)
+      : dataset_{dataset}, cur_{cur}, lines_per_chunk_{lines_per_chunk} {
+    if (!dataset_) {
+      throw std::runtime_error("Initialize ChunkOutputIterator with nullptr!");
+    }
+    if (lines_per_chunk_ <= 0) {
+      throw std::invalid_argument("lines_per_chunk must be positive");
+    }
+    n_samples_ = dataset_->GetRasterXSize();
+    n_lines_ = dataset_->GetRasterYSize();
+    n_bands_ = dataset_->GetRasterCount();
+  }
+
+  /**
+   * @brief 重载赋值符号。
+   *
+   * @param value (k * bands) * samples 的多行块
+   * @return ChunkOutputIterator& 返回*this
+   *
+   * @note 数据写入操作在此处进行。尺寸或类型不符时抛出std::invalid_argument，
+   * 写入失败时抛出std::runtime_error。
+   */
+  ChunkOutputIterator& operator=(const cv::Mat& value) {
+    const int first = cur_ * lines_per_chunk_;
+    const int lines = value.rows / n_bands_;
+    if (value.rows % n_bands_ != 0 || value.cols != n_samples_ ||
+        lines > lines_per_chunk_ || first + lines > n_lines_) {
+      throw std::invalid_argument("chunk size mismatch");
+    }
+    if (value.type() != cv::DataType<T>::type) {
+      throw std::invalid_argument("data type mismatch");
+    }
+    const GSpacing elem_size = value.elemSize();
+    const GSpacing row_step = value.step[0];
+    CPLErr err = dataset_->RasterIO(
+        GF_Write, 0, first, n_samples_, lines, value.data, n_samples_, lines,
+        gdal::DataType<T>::type(), n_bands_, nullptr, elem_size,
+        row_step * n_bands_, row_step);
+    if (err == CE_Failure) {
+      throw std::runtime_error(std::string("GDAL write failed: ") +
+                               CPLGetLastErrorMsg());
+    }
+    return *this;
+  }
+
+  /**
+   * @brief 前缀自增。
+   *
+   * @return ChunkOutputIterator&
+   */
+  ChunkOutputIterator& operator++() {
+    ++cur_;
+    return *this;
+  }
+  /**
+   * @brief 后缀自增。
+   *
+   * @return ChunkOutputIterator
+   */
+  ChunkOutputIterator operator++(int) {
+    ChunkOutputIterator old(*this);
+    ++(*this);
+    return old;
+  }
+  bool operator==(const ChunkOutputIterator& other) const {
+    return cur_ == other.cur_;
+  }
+  bool operator!=(const ChunkOutputIterator& other) const {
+    return !(*this == other);
+  }
+  /**
+   * @brief 迭代器解引用。
+   *
+   * @return ChunkOutputIterator& 返回*this
+   */
+  ChunkOutputIterator& operator*() { return *this; }
+
+ private:
+  GDALDataset* dataset_;
+  int n_samples_{0};
+  int n_lines_{0};
+  int n_bands_{0};
+  int cur_{0};
+  int lines_per_chunk_{1};
+};
+
 }  // namespace hsp
 
 #endif  // HSP_ITERATOR_HPP_
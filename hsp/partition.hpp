@@ -0,0 +1,167 @@
+/**
+ * @file partition.hpp
+ * @author xiaoyc
+ * @brief 将数据集按样本/行/波段范围切分，由多个线程各自使用独立的数据集句柄处理。
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef HSP_PARTITION_HPP_
+#define HSP_PARTITION_HPP_
+
+// GDAL
+#include <gdal.h>
+#include <gdal_priv.h>
+
+// C++ Standard
+#include <algorithm>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// OpenCV
+#include <opencv2/core.hpp>
+
+// project
+#include "./iterator.hpp"
+
+namespace hsp {
+
+/**
+ * @brief 将[0, n)切分为parts个连续且长度相差不超过1的范围。
+ *
+ * @param n 元素个数
+ * @param parts 范围个数，大于n时只切分为n个
+ * @return std::vector<cv::Range>
+ */
+inline std::vector<cv::Range> partition_range(int n, int parts) {
+  parts = std::max(1, std::min(parts, n));
+  std::vector<cv::Range> ranges;
+  for (int k = 0; k < parts; ++k) {
+    ranges.emplace_back(static_cast<int>(static_cast<int64_t>(n) * k / parts),
+                        static_cast<int>(static_cast<int64_t>(n) * (k + 1) /
+                                         parts));
+  }
+  return ranges;
+}
+
+/**
+ * @brief 按样本/行/波段切分数据集，并行处理各个范围。
+ *
+ * @tparam N 切分维度，1为样本，2为行，3为波段，与迭代器的N一致
+ * @tparam F 可调用对象，形如void(GDALDataset* dataset, const cv::Range& range)
+ *
+ * @details
+ * GDAL的数据集句柄不是线程安全的。本函数为每个范围以只读方式单独打开filename，
+ * 在cv::parallel_for_的工作线程中以该句柄和范围调用f，f返回后关闭句柄。
+ * 在f中可以用RandomAccessInputIterator_遍历所分配的范围：
+ *
+ * @code{.cpp}
+ *  hsp::parallel_partition<2>(src_file, [&](GDALDataset* dataset,
+ *                                           const cv::Range& range) {
+ *    hsp::RandomLineInputIterator<uint16_t> beg(dataset, range.start),
+ *        end(dataset, range.end);
+ *    std::transform(beg, end, results.begin() + range.start, ops);
+ *  });
+ * @endcode
+ *
+ * 各范围抛出的异常在全部范围结束后，按范围顺序重新抛出第一个。
+ *
+ * @param filename 数据集路径
+ * @param f 处理一个范围的可调用对象
+ * @param parts 范围个数，不大于0时为cv::getNumThreads()
+ */
+template <unsigned N, typename F>
+void parallel_partition(const std::string& filename, F&& f, int parts = 0) {
+  int n = 0;
+  {
+    auto dataset = GDALDatasetUniquePtr(
+        GDALDataset::FromHandle(GDALOpen(filename.c_str(), GA_ReadOnly)));
+    if (!dataset) {
+      throw std::runtime_error("unable to open " + filename);
+    }
+    const int max_table[] = {dataset->GetRasterXSize(),
+                             dataset->GetRasterYSize(),
+                             dataset->GetRasterCount()};
+    n = max_table[std::min(N, 3u) - 1];
+  }
+  if (n == 0) {
+    return;
+  }
+  const auto ranges =
+      partition_range(n, parts > 0 ? parts : cv::getNumThreads());
+  std::vector<std::exception_ptr> errors(ranges.size());
+  cv::parallel_for_(
+      cv::Range(0, static_cast<int>(ranges.size())),
+      [&](const cv::Range& range) {
+        for (int k = range.start; k < range.end; ++k) {
+          try {
+            auto dataset = GDALDatasetUniquePtr(GDALDataset::FromHandle(
+                GDALOpen(filename.c_str(), GA_ReadOnly)));
+            if (!dataset) {
+              throw std::runtime_error("unable to open " + filename);
+            }
+            f(dataset.get(), ranges[k]);
+          } catch (...) {
+            errors[k] = std::current_exception();
+          }
+        }
+      },
+      static_cast<double>(ranges.size()));
+  for (auto&& error : errors) {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+}
+
+/**
+ * @brief 并行版本的std::transform：对文件src_file的每个切片执行op，写入dst的同一位置。
+ *
+ * @tparam N 切片维度，1为样本，2为行，3为波段
+ * @tparam TIn 读取影像像元的数据类型
+ * @tparam TOut 写入影像像元的数据类型
+ * @tparam UnaryOp 形如cv::Mat(const cv::Mat&)的可调用对象，需要可以被多个线程同时调用
+ *
+ * @details
+ * 读取和计算由parallel_partition()分配的多个线程并行进行，每个线程使用独立的只读句柄；
+ * dst只有一个句柄，写入由互斥锁串行化。
+ *
+ * @code{.cpp}
+ *  hsp::parallel_transform<2, uint16_t>(src_file, dst_dataset.get(), ops);
+ * @endcode
+ *
+ * @param src_file 输入数据集路径
+ * @param dst 输出数据集，尺寸与输入一致
+ * @param op 处理单个切片的操作
+ * @param parts 切分的范围个数，不大于0时为cv::getNumThreads()
+ */
+template <unsigned N, typename TIn, typename TOut = TIn, typename UnaryOp>
+void parallel_transform(const std::string& src_file, GDALDataset* dst,
+                        UnaryOp op, int parts = 0) {
+  if (!dst) {
+    throw std::runtime_error("Transform into nullptr!");
+  }
+  std::mutex write_mutex;
+  parallel_partition<N>(
+      src_file,
+      [&](GDALDataset* dataset, const cv::Range& range) {
+        RandomAccessInputIterator_<TIn, N> it(dataset, range.start),
+            end(dataset, range.end);
+        for (; it != end; ++it) {
+          const cv::Mat result = op(*it);
+          std::lock_guard<std::mutex> lock(write_mutex);
+          *OutputIterator_<TOut, N>(dst, it.index()) = result;
+        }
+      },
+      parts);
+}
+
+}  // namespace hsp
+
+#endif  // HSP_PARTITION_HPP_
@@ -0,0 +1,768 @@
+/**
+ * @file raw_cube.hpp
+ * @author xiaoyc
+ * @brief 不经过GDAL，直接读写ENVI平面文件（BSQ/BIL/BIP）的数据立方。
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef HSP_RAW_CUBE_HPP_
+#define HSP_RAW_CUBE_HPP_
+
+// POSIX
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// C++ Standard
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+// Boost
+#include <boost/filesystem.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/iterator/iterator_facade.hpp>
+
+// OpenCV
+#include <opencv2/core.hpp>
+
+// project
+#include "./envi.hpp"
+#include "./gdal_traits.hpp"
+#include "./interleave.hpp"
+
+namespace hsp {
+
+/**
+ * @brief RawCube的读写方式。
+ *
+ */
+enum class RawIO {
+  Mapped, /**< 内存映射，连续的切片可以零拷贝访问 */
+  Pread,  /**< 通过pread/pwrite按需读写 */
+  Direct  /**< 在Pread的基础上以O_DIRECT打开文件，绕过页缓存，适合只读写一遍的大文件 */
+};
+
+/**
+ * @brief 直接读写ENVI平面文件的数据立方。
+ *
+ * @details
+ * ENVI标准格式的数据文件只是按BSQ、BIL或BIP排列的平面数组，样本/行/波段切片都是固定步长的二维子阵。
+ * 本类解析（或写出）头文件后，按步长直接在映射区域或文件上读写切片，
+ * 没有GDAL的块缓存、锁和逐次RasterIO的开销；像元不做类型转换，也不做字节序转换。
+ *
+ * 切片的形状与GDAL迭代器一致：样本为 bands * lines，行为 bands * samples，波段为 lines * samples。
+ * 通过RawSampleInputIterator、RawLineInputIterator等迭代器，可以直接替换对应的GDAL迭代器。
+ *
+ * RawIO::Mapped方式下，每行像元连续的切片（如BIL的行、BSQ的行和波段）以视图返回，不复制数据；
+ * 只读打开时映射为写时复制，修改视图不会写回文件。
+ * RawIO::Direct方式下，读写按4096字节对齐后经过内部缓冲区，文件系统不支持O_DIRECT时退化为普通读写。
+ *
+ * @par Sample
+ * @code{.cpp}
+ *  hsp::RawCube src("in.dat");
+ *  hsp::RawCube dst("out.dat", src.samples(), src.lines(), src.bands(), 12,
+ *                   hsp::Interleave::BIL);
+ *  hsp::RawLineInputIterator<uint16_t> beg(&src, 0), end(&src, src.lines());
+ *  std::transform(beg, end, hsp::RawLineOutputIterator<uint16_t>(&dst, 0), ops);
+ * @endcode
+ *
+ * @note 仅支持小端序数据，以及ENVI数据类型1、2、3、4、5、12。一个RawCube不应被多个线程同时写入。
+ */
+class RawCube {
+ public:
+  /**
+   * @brief 打开已有的ENVI数据文件。
+   *
+   * @param datafile 数据文件路径，头文件见find_envi_header()
+   * @param io 读写方式
+   * @param writable 是否允许写入
+   */
+  explicit RawCube(const std::string& datafile, RawIO io = RawIO::Mapped,
+                   bool writable = false);
+
+  /**
+   * @brief 创建新的ENVI数据文件及其头文件。已有的文件将被覆盖。
+   *
+   * @param datafile 数据文件路径，头文件为替换扩展名后的.hdr文件
+   * @param samples 样本数
+   * @param lines 行数
+   * @param bands 波段数
+   * @param data_type ENVI数据类型代码，如12为16位无符号整型
+   * @param interleave 交织方式
+   * @param io 读写方式
+   */
+  RawCube(const std::string& datafile, int samples, int lines, int bands,
+          int data_type, Interleave interleave, RawIO io = RawIO::Mapped);
+
+  RawCube(const RawCube&) = delete;
+  RawCube& operator=(const RawCube&) = delete;
+
+  ~RawCube() {
+    try {
+      flush();
+    } catch (...) {
+    }
+    if (fd_ >= 0) {
+      ::close(fd_);
+    }
+  }
+
+  int samples() const { return header_.samples; }
+
+  int lines() const { return header_.lines; }
+
+  int bands() const { return header_.bands; }
+
+  /**
+   * @brief 像元的OpenCV数据类型。
+   *
+   * @return int
+   */
+  int type() const { return type_; }
+
+  Interleave interleave() const { return interleave_; }
+
+  const EnviHeader& header() const { return header_; }
+
+  /**
+   * @brief 读取切片。RawIO::Mapped方式下，行内连续的切片返回映射区域上的视图。
+   *
+   * @param dim 切片维度，1为样本，2为行，3为波段
+   * @param idx 切片序号，从0开始计数
+   * @return cv::Mat
+   */
+  cv::Mat read(unsigned dim, int idx) const;
+
+  /**
+   * @brief 读取切片到out，out尺寸或类型不符时重新分配。
+   *
+   * @param dim 切片维度，1为样本，2为行，3为波段
+   * @param idx 切片序号，从0开始计数
+   * @param out 输出切片
+   */
+  void read(unsigned dim, int idx, cv::Mat& out) const;
+
+  /**
+   * @brief 写入切片。
+   *
+   * @param dim 切片维度，1为样本，2为行，3为波段
+   * @param idx 切片序号，从0开始计数
+   * @param slice 切片，尺寸和类型须与read()的结果一致
+   */
+  void write(unsigned dim, int idx, const cv::Mat& slice);
+
+  /**
+   * @brief 将已写入的数据同步到文件。
+   *
+   */
+  void flush();
+
+ private:
+  /** @brief 切片在文件中的位置，步长以字节计。 */
+  struct Slice {
+    std::size_t offset;
+    int rows;
+    int cols;
+    std::ptrdiff_t row_step;
+    std::ptrdiff_t col_step;
+  };
+
+  static constexpr std::size_t alignment_ = 4096;
+  /** @brief 稀疏切片逐行分段读写时，每段跨越的最大字节数。 */
+  static constexpr std::size_t sparse_window_ = 1 << 20;
+
+  using AlignedBuffer = std::unique_ptr<char, decltype(&std::free)>;
+
+  void open_(bool create);
+  Slice slice_(unsigned dim, int idx) const;
+  std::size_t file_size_() const {
+    return header_.header_offset + static_cast<std::size_t>(elem_) *
+                                       header_.samples * header_.lines *
+                                       header_.bands;
+  }
+  void pread_(char* dst, std::size_t size, std::size_t offset) const;
+  void pwrite_(const char* src, std::size_t size, std::size_t offset);
+
+  /** @brief 分配按alignment_对齐的缓冲区。 */
+  static AlignedBuffer aligned_buffer_(std::size_t size);
+
+  /**
+   * @brief 将[offset, offset + size)读入buffer，返回该区间在buffer中的起始位置。
+   *
+   * @details
+   * RawIO::Direct方式下读取对齐后的整块，buffer需按alignment_对齐，
+   * 且不小于 size + 2 * alignment_ 字节；文件末尾之后的部分填0。
+   */
+  char* read_block_(char* buffer, std::size_t size, std::size_t offset) const;
+
+  /** @brief 将read_block_()读入buffer的同一区间写回文件。 */
+  void write_block_(const char* buffer, std::size_t size, std::size_t offset);
+
+  /** @brief 稀疏切片每段的像元数，每段跨越的字节数不超过sparse_window_。 */
+  int sparse_step_(const Slice& s) const {
+    return static_cast<int>((sparse_window_ - elem_) / s.col_step + 1);
+  }
+
+  /** @brief 按固定步长复制count个元素。 */
+  static void copy_strided_(const char* src, std::ptrdiff_t src_step,
+                            char* dst, std::ptrdiff_t dst_step, int count,
+                            int elem);
+
+ private:
+  std::string filename_;
+  EnviHeader header_;
+  Interleave interleave_{Interleave::BSQ};
+  RawIO io_;
+  bool writable_;
+  int elem_{0};
+  int type_{0};
+  detail::CubeLayout layout_{0, 0, 0};
+  int fd_{-1};
+  boost::interprocess::file_mapping mapping_;
+  boost::interprocess::mapped_region region_;
+};
+
+inline RawCube::RawCube(const std::string& datafile, RawIO io, bool writable)
+    : filename_{datafile}, io_{io}, writable_{writable} {
+  const std::string hdrfile = find_envi_header(datafile);
+  if (hdrfile.empty()) {
+    throw std::runtime_error("unable to find ENVI header of " + datafile);
+  }
+  header_ = read_envi_header(hdrfile);
+  open_(false);
+}
+
+inline RawCube::RawCube(const std::string& datafile, int samples, int lines,
+                        int bands, int data_type, Interleave interleave,
+                        RawIO io)
+    : filename_{datafile}, io_{io}, writable_{true} {
+  static const char* names[] = {"bsq", "bil", "bip"};
+  header_.samples = samples;
+  header_.lines = lines;
+  header_.bands = bands;
+  header_.data_type = data_type;
+  header_.interleave = names[static_cast<int>(interleave)];
+  write_envi_header(
+      boost::filesystem::path(datafile).replace_extension(".hdr").string(),
+      header_);
+  open_(true);
+}
+
+inline void RawCube::open_(bool create) {
+  namespace bip = boost::interprocess;
+  interleave_ = parse_interleave(header_.interleave);
+  elem_ = envi_data_type_size(header_.data_type);
+  switch (header_.data_type) {
+    case 1:
+      type_ = CV_8U;
+      break;
+    case 2:
+      type_ = CV_16S;
+      break;
+    case 3:
+      type_ = CV_32S;
+      break;
+    case 4:
+      type_ = CV_32F;
+      break;
+    case 5:
+      type_ = CV_64F;
+      break;
+    case 12:
+      type_ = CV_16U;
+      break;
+    default:
+      throw std::runtime_error("unsupported ENVI data type " +
+                               std::to_string(header_.data_type));
+  }
+  if (header_.byte_order != 0 && elem_ > 1) {
+    throw std::runtime_error("big-endian ENVI data is not supported");
+  }
+  if (header_.lines <= 0) {
+    throw std::runtime_error("invalid number of lines of " + filename_);
+  }
+  layout_ = detail::CubeLayout::of(interleave_, header_.samples, header_.lines,
+                                   header_.bands);
+
+  int flags = writable_ ? O_RDWR : O_RDONLY;
+  if (create) {
+    flags |= O_CREAT | O_TRUNC;
+  }
+#ifdef O_DIRECT
+  if (io_ == RawIO::Direct) {
+    fd_ = ::open(filename_.c_str(), flags | O_DIRECT, 0644);
+  }
+#endif
+  if (fd_ < 0) {
+    // file systems such as tmpfs refuse O_DIRECT
+    fd_ = ::open(filename_.c_str(), flags, 0644);
+  }
+  if (fd_ < 0) {
+    throw std::runtime_error("unable to open " + filename_ + ": " +
+                             std::strerror(errno));
+  }
+  struct stat st;
+  if (::fstat(fd_, &st) != 0) {
+    throw std::runtime_error("unable to stat " + filename_);
+  }
+  if (static_cast<std::size_t>(st.st_size) < file_size_()) {
+    if (!writable_) {
+      throw std::runtime_error("raw data is shorter than its header: " +
+                               filename_);
+    }
+    if (::ftruncate(fd_, static_cast<off_t>(file_size_())) != 0) {
+      throw std::runtime_error("unable to resize " + filename_);
+    }
+  }
+
+  if (io_ == RawIO::Mapped) {
+    try {
+      mapping_ = bip::file_mapping(
+          filename_.c_str(), writable_ ? bip::read_write : bip::read_only);
+      region_ = bip::mapped_region(
+          mapping_, writable_ ? bip::read_write : bip::copy_on_write, 0,
+          file_size_());
+    } catch (const bip::interprocess_exception&) {
+      throw std::runtime_error("unable to map " + filename_);
+    }
+  }
+}
+
+inline RawCube::Slice RawCube::slice_(unsigned dim, int idx) const {
+  const int max_table[] = {header_.samples, header_.lines, header_.bands};
+  if (dim < 1 || dim > 3) {
+    throw std::invalid_argument("slice dimension must be 1, 2 or 3");
+  }
+  if (idx < 0 || idx >= max_table[dim - 1]) {
+    throw std::out_of_range("Raw cube slice out of range.");
+  }
+  Slice s;
+  switch (dim) {
+    case 1:
+      s = {static_cast<std::size_t>(idx * layout_.pixel), header_.bands,
+           header_.lines, layout_.band, layout_.line};
+      break;
+    case 2:
+      s = {static_cast<std::size_t>(idx * layout_.line), header_.bands,
+           header_.samples, layout_.band, layout_.pixel};
+      break;
+    default:
+      s = {static_cast<std::size_t>(idx * layout_.band), header_.lines,
+           header_.samples, layout_.line, layout_.pixel};
+  }
+  s.offset = header_.header_offset + s.offset * elem_;
+  s.row_step *= elem_;
+  s.col_step *= elem_;
+  return s;
+}
+
+inline cv::Mat RawCube::read(unsigned dim, int idx) const {
+  const Slice s = slice_(dim, idx);
+  if (io_ == RawIO::Mapped && s.col_step == elem_) {
+    // zero-copy
+    return cv::Mat(s.rows, s.cols, type_,
+                   static_cast<char*>(region_.get_address()) + s.offset,
+                   static_cast<std::size_t>(s.row_step));
+  }
+  cv::Mat out;
+  read(dim, idx, out);
+  return out;
+}
+
+inline void RawCube::read(unsigned dim, int idx, cv::Mat& out) const {
+  const Slice s = slice_(dim, idx);
+  out.create(s.rows, s.cols, type_);
+  const std::size_t row_size = static_cast<std::size_t>(s.cols) * elem_;
+  if (io_ == RawIO::Mapped) {
+    const char* base = static_cast<const char*>(region_.get_address());
+    cv::parallel_for_(cv::Range(0, s.rows), [&](const cv::Range& range) {
+      for (int r = range.start; r < range.end; ++r) {
+        copy_strided_(base + s.offset + r * s.row_step, s.col_step,
+                      out.ptr<char>(r), elem_, s.cols, elem_);
+      }
+    });
+    return;
+  }
+  if (s.col_step == elem_) {
+    if (s.row_step == static_cast<std::ptrdiff_t>(row_size)) {
+      pread_(out.ptr<char>(), row_size * s.rows, s.offset);
+    } else {
+      for (int r = 0; r < s.rows; ++r) {
+        pread_(out.ptr<char>(r), row_size, s.offset + r * s.row_step);
+      }
+    }
+    return;
+  }
+  // a dense enough slice (e.g. a BIP line) is read in one go and gathered,
+  // a sparse one (a BSQ/BIL sample) row by row, in bounded windows through
+  // a single aligned buffer
+  const std::size_t span = (s.rows - 1) * s.row_step +
+                           (s.cols - 1) * s.col_step + elem_;
+  if (span <= 16 * row_size * s.rows) {
+    std::unique_ptr<char[]> buffer(new char[span]);
+    pread_(buffer.get(), span, s.offset);
+    for (int r = 0; r < s.rows; ++r) {
+      copy_strided_(buffer.get() + r * s.row_step, s.col_step,
+                    out.ptr<char>(r), elem_, s.cols, elem_);
+    }
+    return;
+  }
+  const int step = sparse_step_(s);
+  AlignedBuffer buffer = aligned_buffer_(sparse_window_ + 2 * alignment_);
+  for (int r = 0; r < s.rows; ++r) {
+    for (int c = 0; c < s.cols; c += step) {
+      const int n = std::min(step, s.cols - c);
+      const char* src =
+          read_block_(buffer.get(), (n - 1) * s.col_step + elem_,
+                      s.offset + r * s.row_step + c * s.col_step);
+      copy_strided_(src, s.col_step, out.ptr<char>(r) + c * elem_, elem_, n,
+                    elem_);
+    }
+  }
+}
+
+inline void RawCube::write(unsigned dim, int idx, const cv::Mat& slice) {
+  if (!writable_) {
+    throw std::runtime_error("Raw cube is opened read-only.");
+  }
+  const Slice s = slice_(dim, idx);
+  if (slice.type() != type_ || slice.rows != s.rows || slice.cols != s.cols) {
+    throw std::invalid_argument("slice does not match the raw cube");
+  }
+  const std::size_t row_size = static_cast<std::size_t>(s.cols) * elem_;
+  if (io_ == RawIO::Mapped) {
+    char* base = static_cast<char*>(region_.get_address());
+    cv::parallel_for_(cv::Range(0, s.rows), [&](const cv::Range& range) {
+      for (int r = range.start; r < range.end; ++r) {
+        copy_strided_(slice.ptr<char>(r), elem_,
+                      base + s.offset + r * s.row_step, s.col_step, s.cols,
+                      elem_);
+      }
+    });
+    return;
+  }
+  if (s.col_step == elem_) {
+    if (s.row_step == static_cast<std::ptrdiff_t>(row_size) &&
+        slice.isContinuous()) {
+      pwrite_(slice.ptr<char>(), row_size * s.rows, s.offset);
+    } else {
+      for (int r = 0; r < s.rows; ++r) {
+        pwrite_(slice.ptr<char>(r), row_size, s.offset + r * s.row_step);
+      }
+    }
+    return;
+  }
+  const std::size_t span = (s.rows - 1) * s.row_step +
+                           (s.cols - 1) * s.col_step + elem_;
+  if (span <= 16 * row_size * s.rows) {
+    // read-modify-write keeps the interleaved neighbours intact
+    std::unique_ptr<char[]> buffer(new char[span]);
+    pread_(buffer.get(), span, s.offset);
+    for (int r = 0; r < s.rows; ++r) {
+      copy_strided_(slice.ptr<char>(r), elem_, buffer.get() + r * s.row_step,
+                    s.col_step, s.cols, elem_);
+    }
+    pwrite_(buffer.get(), span, s.offset);
+    return;
+  }
+  // read-modify-write of bounded windows, see read()
+  const int step = sparse_step_(s);
+  AlignedBuffer buffer = aligned_buffer_(sparse_window_ + 2 * alignment_);
+  for (int r = 0; r < s.rows; ++r) {
+    for (int c = 0; c < s.cols; c += step) {
+      const int n = std::min(step, s.cols - c);
+      const std::size_t size = (n - 1) * s.col_step + elem_;
+      const std::size_t offset = s.offset + r * s.row_step + c * s.col_step;
+      char* dst = read_block_(buffer.get(), size, offset);
+      copy_strided_(slice.ptr<char>(r) + c * elem_, elem_, dst, s.col_step, n,
+                    elem_);
+      write_block_(buffer.get(), size, offset);
+    }
+  }
+}
+
+inline void RawCube::flush() {
+  if (!writable_) {
+    return;
+  }
+  if (io_ == RawIO::Mapped) {
+    if (!region_.flush()) {
+      throw std::runtime_error("unable to flush " + filename_);
+    }
+    return;
+  }
+  // aligned writes may have run past the end of the data
+  if (io_ == RawIO::Direct &&
+      ::ftruncate(fd_, static_cast<off_t>(file_size_())) != 0) {
+    throw std::runtime_error("unable to resize " + filename_);
+  }
+  if (::fsync(fd_) != 0) {
+    throw std::runtime_error("unable to flush " + filename_);
+  }
+}
+
+inline void RawCube::pread_(char* dst, std::size_t size,
+                            std::size_t offset) const {
+  if (io_ == RawIO::Direct) {
+    // O_DIRECT needs aligned offsets, sizes and buffers
+    AlignedBuffer buffer = aligned_buffer_(size + 2 * alignment_);
+    std::memcpy(dst, read_block_(buffer.get(), size, offset), size);
+    return;
+  }
+  read_block_(dst, size, offset);
+}
+
+inline void RawCube::pwrite_(const char* src, std::size_t size,
+                             std::size_t offset) {
+  if (io_ == RawIO::Direct) {
+    // read-modify-write of the aligned blocks around [offset, offset + size)
+    AlignedBuffer buffer = aligned_buffer_(size + 2 * alignment_);
+    char* dst = buffer.get() + offset % alignment_;
+    if (offset % alignment_ != 0 || (offset + size) % alignment_ != 0) {
+      dst = read_block_(buffer.get(), size, offset);
+    }
+    std::memcpy(dst, src, size);
+    write_block_(buffer.get(), size, offset);
+    return;
+  }
+  write_block_(src, size, offset);
+}
+
+inline RawCube::AlignedBuffer RawCube::aligned_buffer_(std::size_t size) {
+  void* aligned = nullptr;
+  if (::posix_memalign(&aligned, alignment_, size) != 0) {
+    throw std::bad_alloc();
+  }
+  return AlignedBuffer(static_cast<char*>(aligned), &std::free);
+}
+
+inline char* RawCube::read_block_(char* buffer, std::size_t size,
+                                  std::size_t offset) const {
+  std::size_t first = offset;
+  std::size_t last = offset + size;
+  if (io_ == RawIO::Direct) {
+    first = offset / alignment_ * alignment_;
+    last = (offset + size + alignment_ - 1) / alignment_ * alignment_;
+  }
+  std::size_t done = 0;
+  while (done < last - first) {
+    const ssize_t n = ::pread(fd_, buffer + done, last - first - done,
+                              static_cast<off_t>(first + done));
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      break;  // end of file inside the last block
+    }
+    done += n;
+  }
+  if (done < offset + size - first) {
+    throw std::runtime_error("unable to read " + filename_);
+  }
+  std::memset(buffer + done, 0, last - first - done);
+  return buffer + (offset - first);
+}
+
+inline void RawCube::write_block_(const char* buffer, std::size_t size,
+                                  std::size_t offset) {
+  std::size_t first = offset;
+  std::size_t last = offset + size;
+  if (io_ == RawIO::Direct) {
+    first = offset / alignment_ * alignment_;
+    last = (offset + size + alignment_ - 1) / alignment_ * alignment_;
+  }
+  std::size_t done = 0;
+  while (done < last - first) {
+    const ssize_t n = ::pwrite(fd_, buffer + done, last - first - done,
+                               static_cast<off_t>(first + done));
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      throw std::runtime_error("unable to write " + filename_);
+    }
+    done += n;
+  }
+}
+
+inline void RawCube::copy_strided_(const char* src, std::ptrdiff_t src_step,
+                                   char* dst, std::ptrdiff_t dst_step,
+                                   int count, int elem) {
+  if (src_step == elem && dst_step == elem) {
+    std::memcpy(dst, src, static_cast<std::size_t>(count) * elem);
+    return;
+  }
+  // fixed-size copies so that the compiler emits plain loads and stores
+  auto copy = [&](auto tag) {
+    using E = typename decltype(tag)::type;
+    for (int i = 0; i < count; ++i) {
+      std::memcpy(dst + i * dst_step, src + i * src_step, sizeof(E));
+    }
+  };
+  switch (elem) {
+    case 1:
+      copy(gdal::TypeTag<uint8_t>());
+      break;
+    case 2:
+      copy(gdal::TypeTag<uint16_t>());
+      break;
+    case 4:
+      copy(gdal::TypeTag<uint32_t>());
+      break;
+    default:
+      copy(gdal::TypeTag<uint64_t>());
+  }
+}
+
+/**
+ * @brief RawCube的随机访问输入迭代器，用于特化为其他迭代器。
+ *
+ * @tparam T 像元数据类型，须与数据立方的数据类型一致
+ * @tparam N 特化迭代器类型，1为样本迭代器，2为行迭代器，3为波段迭代器
+ *
+ * @details
+ * 解引用时读取切片，见RawCube::read()。
+ *
+ * 与RandomAccessInputIterator_相同，解引用按值返回，只有boost的遍历类别是随机访问，
+ * std::iterator_traits的iterator_category只能是输入迭代器。
+ * 默认构造的迭代器不指向数据立方，只能用于赋值，解引用时抛出std::runtime_error。
+ */
+template <typename T, unsigned N>
+class RawInputIterator_
+    : public boost::iterator_facade<RawInputIterator_<T, N>, cv::Mat const,
+                                    boost::random_access_traversal_tag,
+                                    cv::Mat> {
+  friend boost::iterator_core_access;
+
+ public:
+  /** @brief 读取影像像元的数据类型。 */
+  using pixel_type = T;
+
+  RawInputIterator_() = default;
+
+  /**
+   * @brief 构造函数。
+   *
+   * @param cube 数据立方
+   * @param cur 当前位置，从0开始计数；末端迭代器为样本/行/波段数
+   */
+  RawInputIterator_(const RawCube* cube, int cur) : cube_{cube}, cur_{cur} {
+    if (!cube) {
+      throw std::runtime_error("Initialize raw iterator with nullptr!");
+    }
+    if (cube->type() != cv::DataType<T>::type) {
+      throw std::invalid_argument("pixel type does not match the raw cube");
+    }
+  }
+
+  int index() const { return cur_; }
+
+ private:
+  const RawCube* cube_{nullptr};
+  int cur_{0};
+
+ private:
+  cv::Mat dereference() const {
+    if (!cube_) {
+      throw std::runtime_error("Dereference raw iterator without cube!");
+    }
+    return cube_->read(N, cur_);
+  }
+  bool equal(RawInputIterator_ const& other) const {
+    return cur_ == other.cur_;
+  }
+  void increment() { ++cur_; }
+  void decrement() { --cur_; }
+  void advance(std::ptrdiff_t n) { cur_ += static_cast<int>(n); }
+  std::ptrdiff_t distance_to(RawInputIterator_ const& other) const {
+    return other.cur_ - cur_;
+  }
+};
+
+/**
+ * @brief RawCube的输出迭代器，用于特化为其他迭代器。
+ *
+ * @tparam T 像元数据类型，须与数据立方的数据类型一致
+ * @tparam N 特化迭代器类型，1为样本迭代器，2为行迭代器，3为波段迭代器
+ */
+template <typename T, unsigned N>
+class RawOutputIterator_
+    : public std::iterator<std::output_iterator_tag, void, void, void, void> {
+ public:
+  /**
+   * @brief 构造函数。
+   *
+   * @param cube 数据立方，须可写
+   * @param cur 当前位置，从0开始计数
+   */
+  RawOutputIterator_(RawCube* cube, int cur) : cube_{cube}, cur_{cur} {
+    if (!cube) {
+      throw std::runtime_error("Initialize raw iterator with nullptr!");
+    }
+    if (cube->type() != cv::DataType<T>::type) {
+      throw std::invalid_argument("pixel type does not match the raw cube");
+    }
+  }
+
+  RawOutputIterator_& operator=(const cv::Mat& value) {
+    cube_->write(N, cur_, value);
+    return *this;
+  }
+
+  RawOutputIterator_& operator*() { return *this; }
+
+  RawOutputIterator_& operator++() {
+    ++cur_;
+    return *this;
+  }
+
+  RawOutputIterator_ operator++(int) {
+    RawOutputIterator_ tmp = *this;
+    ++cur_;
+    return tmp;
+  }
+
+ private:
+  RawCube* cube_;
+  int cur_;
+};
+
+/** @brief RawCube样本输入迭代器，见RawInputIterator_。 */
+template <typename T>
+using RawSampleInputIterator = RawInputIterator_<T, 1>;
+
+/** @brief RawCube行输入迭代器，见RawInputIterator_。 */
+template <typename T>
+using RawLineInputIterator = RawInputIterator_<T, 2>;
+
+/** @brief RawCube波段输入迭代器，见RawInputIterator_。 */
+template <typename T>
+using RawBandInputIterator = RawInputIterator_<T, 3>;
+
+/** @brief RawCube样本输出迭代器，见RawOutputIterator_。 */
+template <typename T>
+using RawSampleOutputIterator = RawOutputIterator_<T, 1>;
+
+/** @brief RawCube行输出迭代器，见RawOutputIterator_。 */
+template <typename T>
+using RawLineOutputIterator = RawOutputIterator_<T, 2>;
+
+/** @brief RawCube波段输出迭代器，见RawOutputIterator_。 */
+template <typename T>
+using RawBandOutputIterator = RawOutputIterator_<T, 3>;
+
+}  // namespace hsp
+
+#endif  // HSP_RAW_CUBE_HPP_
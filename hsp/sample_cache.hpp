@@ -0,0 +1,234 @@
+/**
+ * @file sample_cache.hpp
+ * @author xiaoyc
+ * @brief 转置缓存，用于快速按样本（列）访问数据立方。
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef HSP_SAMPLE_CACHE_HPP_
+#define HSP_SAMPLE_CACHE_HPP_
+
+// GDAL
+#include <gdal.h>
+#include <gdal_priv.h>
+
+// C++ Standard
+#include <cstddef>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+// Boost
+#include <boost/filesystem.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/iterator/iterator_facade.hpp>
+
+// OpenCV
+#include <opencv2/core.hpp>
+
+// project
+#include "./iterator.hpp"
+#include "./transpose.hpp"
+
+namespace hsp {
+
+/**
+ * @brief 转置缓存的存储位置。
+ *
+ */
+enum class CacheStorage {
+  Memory, /**< 缓存在内存中 */
+  Mapped  /**< 缓存在临时文件中，通过内存映射访问，适合大于内存的数据 */
+};
+
+/**
+ * @brief 按样本转置的数据立方缓存。
+ *
+ * @tparam T 像元数据类型
+ *
+ * @details
+ * SampleInputIterator每步读取宽度为1的一列，在按行存储的文件上每一列都要访问全部的块。
+ * 本类在构造时以K行为一块顺序读取整个数据立方一次，分块转置为按样本连续存放的布局：
+ * 第x个样本为 bands * lines 的连续矩阵，与SampleInputIterator的值相同。
+ * 之后按样本访问不再读取文件，也不产生复制。
+ *
+ * @par Sample
+ * @code{.cpp}
+ *  hsp::SampleCache<uint16_t> cache(src_dataset);
+ *  hsp::SampleOutputIterator<uint16_t> out(dst_dataset, 0);
+ *  std::transform(cache.begin(), cache.end(), out, column_calibration);
+ * @endcode
+ *
+ * @note 构造完成后不再访问数据集。缓存大小与数据立方相同。
+ */
+template <typename T>
+class SampleCache {
+ public:
+  /**
+   * @brief 构造函数。读取并转置整个数据立方。
+   *
+   * @param dataset 数据集指针
+   * @param storage 缓存存储位置
+   * @param lines_per_read 每次读取的行数
+   * @param scratch_dir CacheStorage::Mapped时临时文件所在目录，默认为系统临时目录
+   */
+  explicit SampleCache(GDALDataset* dataset,
+                       CacheStorage storage = CacheStorage::Memory,
+                       int lines_per_read = 64,
+                       const std::string& scratch_dir = "");
+
+  SampleCache(const SampleCache&) = delete;
+  SampleCache& operator=(const SampleCache&) = delete;
+
+  ~SampleCache() { release_(); }
+
+  /**
+   * @brief 第x个样本，为 bands * lines 的矩阵，直接指向缓存。
+   *
+   * @param x 样本序号，从0开始计数
+   * @return cv::Mat
+   */
+  cv::Mat sample(int x) const {
+    if (x < 0 || x >= n_samples_) {
+      throw std::out_of_range("");
+    }
+    return cv::Mat(n_bands_, n_lines_, cv::DataType<T>::type,
+                   data_ + static_cast<size_t>(x) * n_bands_ * n_lines_);
+  }
+
+  int samples() const { return n_samples_; }
+
+  int lines() const { return n_lines_; }
+
+  int bands() const { return n_bands_; }
+
+  /**
+   * @brief 样本迭代器，随机访问，解引用得到sample(x)。
+   *
+   */
+  class Iterator
+      : public boost::iterator_facade<Iterator, cv::Mat const,
+                                      boost::random_access_traversal_tag,
+                                      cv::Mat> {
+    friend boost::iterator_core_access;
+
+   public:
+    Iterator(const SampleCache* cache, int cur) : cache_{cache}, cur_{cur} {}
+
+   private:
+    const SampleCache* cache_;
+    int cur_;
+
+    cv::Mat dereference() const { return cache_->sample(cur_); }
+    bool equal(const Iterator& other) const { return cur_ == other.cur_; }
+    void increment() { ++cur_; }
+    void decrement() { --cur_; }
+    void advance(std::ptrdiff_t n) { cur_ += static_cast<int>(n); }
+    std::ptrdiff_t distance_to(const Iterator& other) const {
+      return other.cur_ - cur_;
+    }
+  };
+
+  Iterator begin() const { return Iterator(this, 0); }
+
+  Iterator end() const { return Iterator(this, n_samples_); }
+
+ private:
+  int n_samples_{0};
+  int n_lines_{0};
+  int n_bands_{0};
+  T* data_{nullptr};
+  std::unique_ptr<T[]> memory_;
+  boost::filesystem::path scratch_file_;
+  boost::interprocess::file_mapping mapping_;
+  boost::interprocess::mapped_region region_;
+
+ private:
+  void allocate_(CacheStorage storage, const std::string& scratch_dir);
+
+  void release_() {
+    region_ = boost::interprocess::mapped_region();
+    if (!scratch_file_.empty()) {
+      boost::system::error_code ec;
+      boost::filesystem::remove(scratch_file_, ec);
+      scratch_file_.clear();
+    }
+  }
+};
+
+template <typename T>
+SampleCache<T>::SampleCache(GDALDataset* dataset, CacheStorage storage,
+                            int lines_per_read,
+                            const std::string& scratch_dir) {
+  if (!dataset) {
+    throw std::runtime_error("Initialize SampleCache with nullptr!");
+  }
+  n_samples_ = dataset->GetRasterXSize();
+  n_lines_ = dataset->GetRasterYSize();
+  n_bands_ = dataset->GetRasterCount();
+
+  // one pass over the file; every band of a chunk is a lines x samples
+  // matrix that is transposed into the samples x lines plane of that band
+  const std::ptrdiff_t line_size =
+      static_cast<std::ptrdiff_t>(n_bands_) * n_samples_;
+  const std::ptrdiff_t sample_size =
+      static_cast<std::ptrdiff_t>(n_bands_) * n_lines_;
+  try {
+    // inside the try, so that a scratch file is removed if it can not be
+    // resized or mapped
+    allocate_(storage, scratch_dir);
+    ChunkInputIterator<T> it(dataset, 0, lines_per_read),
+        end(dataset, lines_per_read);
+    for (; it != end; ++it) {
+      const cv::Mat& chunk = *it;
+      const int y0 = it.first_line();
+      const int lines = chunk.rows / n_bands_;
+      cv::parallel_for_(cv::Range(0, n_bands_), [&](const cv::Range& range) {
+        for (int b = range.start; b < range.end; ++b) {
+          transpose_2d(chunk.ptr<T>(b), line_size,
+                       data_ + static_cast<std::ptrdiff_t>(b) * n_lines_ + y0,
+                       sample_size, lines, n_samples_);
+        }
+      });
+    }
+  } catch (...) {
+    release_();
+    throw;
+  }
+}
+
+template <typename T>
+void SampleCache<T>::allocate_(CacheStorage storage,
+                               const std::string& scratch_dir) {
+  namespace bip = boost::interprocess;
+  namespace fs = boost::filesystem;
+  const size_t size =
+      sizeof(T) * n_samples_ * static_cast<size_t>(n_lines_) * n_bands_;
+  if (storage == CacheStorage::Memory) {
+    memory_.reset(new T[size / sizeof(T)]);
+    data_ = memory_.get();
+    return;
+  }
+  const fs::path dir =
+      scratch_dir.empty() ? fs::temp_directory_path() : fs::path(scratch_dir);
+  scratch_file_ = dir / fs::unique_path("hsp-%%%%-%%%%-%%%%.cache");
+  std::ofstream(scratch_file_.string(), std::ios::binary);
+  fs::resize_file(scratch_file_, size);
+  try {
+    mapping_ = bip::file_mapping(scratch_file_.string().c_str(),
+                                 bip::read_write);
+    region_ = bip::mapped_region(mapping_, bip::read_write);
+  } catch (const bip::interprocess_exception&) {
+    throw std::runtime_error("unable to map sample cache");
+  }
+  data_ = static_cast<T*>(region_.get_address());
+}
+
+}  // namespace hsp
+
+#endif  // HSP_SAMPLE_CACHE_HPP_
@@ -0,0 +1,57 @@
+/**
+ * @file transpose.hpp
+ * @author xiaoyc
+ * @brief 分块（cache-blocked）矩阵转置。
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef HSP_TRANSPOSE_HPP_
+#define HSP_TRANSPOSE_HPP_
+
+// C++ Standard
+#include <algorithm>
+#include <cstddef>
+
+namespace hsp {
+
+/**
+ * @brief 将rows * cols的矩阵src转置到cols * rows的矩阵dst。
+ *
+ * @details
+ * 按tile * tile的小块转置：每个小块的读写都落在少量缓存行内，避免逐列写入时每个元素一次缓存缺失。
+ * 小块内是固定步长的简单循环，便于编译器向量化。src和dst可以是更大矩阵的一部分，
+ * 行间距以元素个数给出。
+ *
+ * @tparam T 元素类型
+ * @param src 源矩阵起始地址
+ * @param src_stride 源矩阵行间距（元素个数）
+ * @param dst 目标矩阵起始地址
+ * @param dst_stride 目标矩阵行间距（元素个数）
+ * @param rows 源矩阵行数
+ * @param cols 源矩阵列数
+ */
+template <typename T>
+void transpose_2d(const T* src, std::ptrdiff_t src_stride, T* dst,
+                  std::ptrdiff_t dst_stride, int rows, int cols) {
+  constexpr int tile = 64 / sizeof(T) < 8 ? 8 : 64 / sizeof(T);
+  for (int r0 = 0; r0 < rows; r0 += tile) {
+    const int r1 = std::min(r0 + tile, rows);
+    for (int c0 = 0; c0 < cols; c0 += tile) {
+      const int c1 = std::min(c0 + tile, cols);
+      for (int c = c0; c < c1; ++c) {
+        T* out = dst + c * dst_stride;
+        const T* in = src + c;
+        for (int r = r0; r < r1; ++r) {
+          out[r] = in[r * src_stride];
+        }
+      }
+    }
+  }
+}
+
+}  // namespace hsp
+
+#endif  // HSP_TRANSPOSE_HPP_
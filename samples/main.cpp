@@ -33,6 +33,9 @@
 #include "../hsp/algorithm/radiometric.hpp"
 #include "../hsp/core.hpp"
 #include "../hsp/decoder/AHSIData.hpp"
+#include "../hsp/decoder/FramePrefetcher.hpp"
+#include "../hsp/decoder/SegmentedData.hpp"
+#include "../hsp/interleave.hpp"
 #include "./order_parser.hpp"
 
 using parser::Coeff;
@@ -53,21 +56,21 @@ namespace po = boost::program_options;
  * @param output
  */
 
-void img_process(Input input, Coeff coeff, const std::string& output) {
+void img_process(Input input, Coeff coeff, const std::string& output,
+                 const hsp::gdal::IOConfig& io, int threads) {
   auto src_dataset = GDALDatasetUniquePtr(
       GDALDataset::FromHandle(GDALOpen(input.filename.c_str(), GA_ReadOnly)));
   int n_samples = src_dataset->GetRasterXSize();
   int n_lines = src_dataset->GetRasterYSize();
   int n_bands = src_dataset->GetRasterCount();
 
-  auto poDriver = GetGDALDriverManager()->GetDriverByName("GTiff");
-  auto dst_dataset = GDALDatasetUniquePtr(GDALDataset::FromHandle(
-      poDriver->Create(output.c_str(), n_samples, n_lines, n_bands,
-                       hsp::gdal::DataType<uint16_t>::type(), nullptr)));
+  auto dst_dataset = GDALDatasetUniquePtr(
+      io.create("GTiff", output.c_str(), n_samples, n_lines, n_bands,
+                hsp::gdal::DataType<uint16_t>::type()));
 
-  hsp::LineInputIterator<uint16_t> beg(src_dataset.get(), 0),
+  hsp::LineInputIterator<uint16_t> beg(src_dataset.get(), 0, io),
       end(src_dataset.get());
-  hsp::LineOutputIterator<uint16_t> obeg(dst_dataset.get(), 0);
+  hsp::LineOutputIterator<uint16_t> obeg(dst_dataset.get(), 0, io);
   auto dbc = hsp::make_op<hsp::DarkBackgroundCorrection<uint16_t>>();
   dbc->load(coeff.dark_b);
   auto etalon = hsp::make_op<hsp::NonUniformityCorrection<double, double>>();
@@ -77,9 +80,13 @@ void img_process(Input input, Coeff coeff, const std::string& output) {
   auto dpc = hsp::make_op<hsp::DefectivePixelCorrectionIDW>();
   dpc->load(coeff.badpixel);
 
+  // DBC, etalon and NUC run as one fused pass per line; the result differs
+  // from running them one by one by at most 1 DN
   hsp::UnaryOpCombo ops;
-  ops.add(dbc).add(etalon).add(nuc).add(dpc);
-  std::transform(beg, end, obeg, ops);
+  ops.set_fusion(true).add(dbc).add(etalon).add(nuc).add(dpc);
+  // lines are read, corrected by a worker pool and written back in order
+  obeg = hsp::ordered_transform(beg, end, obeg, ops, threads);
+  obeg.close();
 }
 
 /**
@@ -89,34 +96,40 @@ void img_process(Input input, Coeff coeff, const std::string& output) {
  * @param coeff
  * @param output
  */
-void raw_process(Input input, Coeff coeff, const std::string& output) {
-  hsp::AHSIData L0_data(input.filename);
+void raw_process(Input input, Coeff coeff, const std::string& output,
+                 const hsp::gdal::IOConfig& io) {
+  // all segments are processed as one strip into a single output
+  std::vector<std::string> segments{input.filename};
+  segments.insert(segments.end(), input.segments.begin(),
+                  input.segments.end());
+  // frames are zero-copy views of the mapped segments, which stay mapped
+  // while the prefetcher runs
+  hsp::SegmentedData<hsp::AHSIData> L0_data(segments, hsp::ReadMode::Mapped);
   L0_data.Traverse();
 
-  auto poDriver = GetGDALDriverManager()->GetDriverByName("GTiff");
-  char** papszOptions{nullptr};
-  // papszOptions = CSLSetNameValue(papszOptions, "INTERLEAVE", "BIL");
-  if (!poDriver) {
-    return;
-  }
-  auto dst_dataset =
-      GDALDatasetUniquePtr(GDALDataset::FromHandle(poDriver->Create(
-          output.c_str(), L0_data.samples(), L0_data.lines(), L0_data.bands(),
-          hsp::gdal::DataType<uint16_t>::type(), papszOptions)));
+  auto dst_dataset = GDALDatasetUniquePtr(io.create(
+      "GTiff", output.c_str(), L0_data.samples(), L0_data.lines(),
+      L0_data.bands(), hsp::gdal::DataType<uint16_t>::type()));
   if (!dst_dataset) {
     return;
   }
-  hsp::LineOutputIterator<uint16_t> output_it(dst_dataset.get(), 0);
+  // lines are written by a writer thread, in batches
+  hsp::LineOutputIterator<uint16_t> output_it(
+      dst_dataset.get(), 0, io.write_queue > 0 ? io.write_queue : 8);
 
   hsp::GF501A_DBC dbc;
   dbc.load(coeff.dark_a, coeff.dark_b);
   hsp::DefectivePixelCorrectionIDW dpc;
   dpc.load(coeff.badpixel);
   // int i{0};
-  for (auto&& frame : L0_data) {
+  // frames are decoded by a background thread while this one computes
+  hsp::FramePrefetcher<hsp::AHSIFrame> frames(
+      &L0_data, io.prefetch > 0 ? io.prefetch : 16);
+  for (auto&& frame : frames) {
     *output_it++ = dpc(dbc(frame));
     // spdlog::debug("Frame {}", i++);
   }
+  output_it.close();
 }
 
 /**
@@ -134,6 +147,15 @@ int main(int argc, char* argv[]) {
       "help", "produce help message")("config,c", po::value<std::string>(),
                                       "config file");
 
+  po::options_description convert("Interleave conversion");
+  convert.add_options()(
+      "interleave,i", po::value<std::string>(),
+      "convert input rasters to BSQ, BIL or BIP instead of processing orders")(
+      "output,o", po::value<std::vector<std::string>>(),
+      "output raster of each input")(
+      "max-memory", po::value<std::size_t>()->default_value(256),
+      "buffer size of the conversion in MiB");
+
   po::options_description hidden("Hidden options");
   hidden.add_options()("input-file", po::value<std::vector<std::string>>(),
                        "input file");
@@ -142,7 +164,7 @@ int main(int argc, char* argv[]) {
   positional.add("input-file", -1);
 
   po::options_description cmdline_options;
-  cmdline_options.add(generic).add(hidden);
+  cmdline_options.add(generic).add(convert).add(hidden);
 
   po::variables_map vm;
   po::store(po::command_line_parser(argc, argv)
@@ -175,7 +197,24 @@ int main(int argc, char* argv[]) {
   GDALAllRegister();
 
   std::vector<std::string> input_files;
-  if (vm.count("input-file")) {
+  if (vm.count("interleave") && vm.count("input-file")) {
+    // hsp -i BIL -o out.bil in.tif
+    input_files = vm["input-file"].as<decltype(input_files)>();
+    const auto interleave =
+        hsp::parse_interleave(vm["interleave"].as<std::string>());
+    const auto outputs = vm.count("output")
+                             ? vm["output"].as<std::vector<std::string>>()
+                             : std::vector<std::string>();
+    if (outputs.size() != input_files.size()) {
+      spdlog::error("Each input needs an output");
+      return 1;
+    }
+    for (std::size_t i = 0; i < input_files.size(); ++i) {
+      spdlog::info("Convert {} to {}", input_files[i], outputs[i]);
+      hsp::convert_interleave(input_files[i], outputs[i], interleave,
+                              vm["max-memory"].as<std::size_t>() << 20);
+    }
+  } else if (vm.count("input-file")) {
     input_files = vm["input-file"].as<decltype(input_files)>();
     for (auto&& each : input_files) {
       std::ifstream ifs(each);
@@ -184,13 +223,17 @@ int main(int argc, char* argv[]) {
       opt.allow_comments = true;
       opt.allow_trailing_commas = true;
       Order order = json::value_to<Order>(json::parse(input, {}, opt));
+      order.io.apply();
+      spdlog::info("GDAL I/O: {}", order.io.describe());
 
       // #pragma omp parallel for
       for (int i = 0; i < order.inputs.size(); ++i) {
         if (order.inputs[i].is_raw) {
-          raw_process(order.inputs[i], order.coeff, order.outputs.at(i));
+          raw_process(order.inputs[i], order.coeff, order.outputs.at(i),
+                      order.io);
         } else {
-          img_process(order.inputs[i], order.coeff, order.outputs.at(i));
+          img_process(order.inputs[i], order.coeff, order.outputs.at(i),
+                      order.io, order.threads);
         }
       }
     }
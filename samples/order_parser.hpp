@@ -12,18 +12,24 @@
 #define SAMPLES_ORDER_PARSER_HPP_
 
 // C++ Standard
+#include <map>
 #include <string>
 #include <vector>
 
 // Boost
 #include <boost/json/src.hpp>
 
+// hsp
+#include "../hsp/io_config.hpp"
+
 namespace json = boost::json;
 
 namespace parser {
 struct Input {
   std::string filename;
   bool is_raw{false};
+  // consecutive segments following filename, processed as one strip
+  std::vector<std::string> segments;
 
   friend Input tag_invoke(boost::json::value_to_tag<Input>,
                           boost::json::value const& v);
@@ -46,6 +52,10 @@ struct Order {
   std::vector<Input> inputs;
   Coeff coeff;
   std::vector<std::string> outputs;
+  // optional GDAL cache and I/O settings of the job
+  hsp::gdal::IOConfig io;
+  // worker threads of the correction pipeline, 0 for cv::getNumThreads()
+  int threads{0};
   friend Order tag_invoke(boost::json::value_to_tag<Order>,
                           boost::json::value const& v);
 };
@@ -65,15 +75,44 @@ Input tag_invoke(boost::json::value_to_tag<Input>,
   Input input;
   extract(obj, input.filename, "filename");
   extract(obj, input.is_raw, "raw");
+  if (obj.contains("segments")) {
+    extract(obj, input.segments, "segments");
+  }
   return input;
 }
 
+hsp::gdal::IOConfig parse_io_config(json::object const& obj) {
+  hsp::gdal::IOConfig io;
+  auto optional = [&](auto& t, const char* key) {
+    if (obj.contains(key)) {
+      extract(obj, t, key);
+    }
+  };
+  optional(io.cache_max_mb, "cache_max_mb");
+  optional(io.num_threads, "num_threads");
+  optional(io.block_x, "block_x");
+  optional(io.block_y, "block_y");
+  optional(io.interleave, "interleave");
+  optional(io.compress, "compress");
+  optional(io.options, "options");
+  optional(io.advise_read, "advise_read");
+  optional(io.prefetch, "prefetch");
+  optional(io.write_queue, "write_queue");
+  return io;
+}
+
 Order tag_invoke(json::value_to_tag<Order>, json::value const& v) {
   auto const& obj = v.as_object();
   Order order;
   extract(obj, order.inputs, "input");
   extract(obj, order.coeff, "coeff");
   extract(obj, order.outputs, "output");
+  if (obj.contains("io")) {
+    order.io = parse_io_config(obj.at("io").as_object());
+  }
+  if (obj.contains("threads")) {
+    extract(obj, order.threads, "threads");
+  }
   return order;
 }
 
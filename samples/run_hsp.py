@@ -27,7 +27,9 @@ class Order(object):
     json_order = {
       "input": [self.input],
       "coeff": self.coeff,
-      "output": [output]
+      "output": [output],
+      # parallel jobs share the memory and the cores
+      "io": {"cache_max_mb": 256, "num_threads": 1}
     }
     with open(filename, "w") as f:
       json.dump(json_order, f, indent=2)
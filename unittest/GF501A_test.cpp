@@ -16,6 +16,10 @@
 #include <gtest/gtest.h>
 
 // C++ Standard
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
 
 // Boost
 #include <boost/filesystem.hpp>
@@ -26,6 +30,7 @@
 #include "../hsp/algorithm/radiometric.hpp"
 #include "../hsp/core.hpp"
 #include "../hsp/decoder/AHSIData.hpp"
+#include "../hsp/decoder/FramePrefetcher.hpp"
 
 namespace fs = boost::filesystem;
 using hsp::AHSIData;
@@ -125,6 +130,275 @@ TEST_F(GF501AVNIRTest, VNIRProcessing) {
   SUCCEED();
 }
 
+TEST_F(GF501AVNIRTest, MappedFrameEqualsStreamFrame) {
+  AHSIData mapped_data(src_file.string(), hsp::ReadMode::Mapped);
+  mapped_data.Traverse();
+  ASSERT_EQ(mapped_data.lines(), L0_data.lines());
+  for (int i : {0, 1, L0_data.lines() / 2, L0_data.lines() - 1}) {
+    auto mapped_frame = mapped_data.GetFrame(i);
+    auto frame = L0_data.GetFrame(i);
+    EXPECT_EQ(mapped_frame.index, frame.index);
+    EXPECT_EQ(cv::norm(mapped_frame.data, frame.data, cv::NORM_INF), 0);
+  }
+}
+
+TEST_F(GF501AVNIRTest, ReentrantGetFrame) {
+  auto frame0 = L0_data.GetFrame(0);
+  auto frame1 = L0_data.GetFrame(1);
+  EXPECT_NE(frame0.data.data, frame1.data.data);
+
+  const int n_frames = std::min(L0_data.lines(), 64);
+  std::vector<cv::Mat> parallel(n_frames);
+  cv::parallel_for_(cv::Range(0, n_frames), [&](const cv::Range& range) {
+    cv::Mat buffer;
+    for (int i = range.start; i < range.end; ++i) {
+      parallel[i] = L0_data.GetFrame(i, buffer).data.clone();
+    }
+  });
+  for (int i = 0; i < n_frames; ++i) {
+    EXPECT_EQ(cv::norm(parallel[i], L0_data.GetFrame(i).data, cv::NORM_INF),
+              0);
+  }
+}
+
+TEST_F(GF501AVNIRTest, GetFrames) {
+  const int first = 3;
+  const int count = 16;
+  cv::Mat block;
+  L0_data.GetFrames(first, count, block);
+  ASSERT_EQ(block.dims, 3);
+  ASSERT_EQ(block.size[0], count);
+  AHSIData mapped_data(src_file.string(), hsp::ReadMode::Mapped);
+  mapped_data.Traverse();
+  cv::Mat mapped_block;
+  mapped_data.GetFrames(first, count, mapped_block);
+  for (int k = 0; k < count; ++k) {
+    cv::Mat frame(L0_data.bands(), L0_data.samples(), block.type(),
+                  block.ptr(k));
+    cv::Mat mapped_frame(L0_data.bands(), L0_data.samples(), block.type(),
+                         mapped_block.ptr(k));
+    auto expected = L0_data.GetFrame(first + k);
+    EXPECT_EQ(cv::norm(frame, expected.data, cv::NORM_INF), 0);
+    EXPECT_EQ(cv::norm(mapped_frame, expected.data, cv::NORM_INF), 0);
+    EXPECT_EQ(L0_data.frame_index(first + k), expected.index);
+  }
+  EXPECT_THROW(L0_data.GetFrames(L0_data.lines() - 1, 2, block),
+               std::out_of_range);
+}
+
+TEST_F(GF501AVNIRTest, FramePrefetcher) {
+  hsp::FramePrefetcher<AHSIFrame> frames(&L0_data, 4);
+  int i = 0;
+  for (auto&& frame : frames) {
+    auto expected = L0_data.GetFrame(i++);
+    ASSERT_EQ(frame.index, expected.index);
+    ASSERT_EQ(cv::norm(frame.data, expected.data, cv::NORM_INF), 0);
+  }
+  EXPECT_EQ(i, L0_data.lines());
+}
+
+TEST_F(GF501AVNIRTest, FramePrefetcherEarlyExit) {
+  hsp::FramePrefetcher<AHSIFrame> frames(&L0_data, 2);
+  auto it = frames.begin();
+  ++it;
+  EXPECT_EQ((*it).index, L0_data.GetFrame(1).index);
+}
+
+TEST_F(GF501AVNIRTest, FrameIndexFile) {
+  AHSIData scanned(src_file.string());
+  scanned.set_use_index(false);
+  scanned.Traverse();
+  const fs::path index_dir = work_dir / fs::path("index");
+  fs::create_directories(index_dir);
+  AHSIData indexed(src_file.string());
+  indexed.set_use_index(true);
+  indexed.set_index_dir(index_dir.string());
+  indexed.Traverse();
+  ASSERT_TRUE(fs::exists(indexed.index_file()));
+  EXPECT_EQ(fs::path(indexed.index_file()).parent_path(), index_dir);
+  AHSIData reloaded(src_file.string());
+  reloaded.set_use_index(true);
+  reloaded.set_index_dir(index_dir.string());
+  reloaded.Traverse();
+  EXPECT_EQ(reloaded.sensor_type(), scanned.sensor_type());
+  EXPECT_EQ(reloaded.samples(), scanned.samples());
+  EXPECT_EQ(reloaded.bands(), scanned.bands());
+  ASSERT_EQ(reloaded.lines(), scanned.lines());
+  auto frame = reloaded.GetFrame(scanned.lines() - 1);
+  EXPECT_EQ(frame.index, scanned.GetFrame(scanned.lines() - 1).index);
+}
+
+TEST(GF501ATest, FindMarker) {
+  const char marker[4] = {0x09, 0x15, static_cast<char>(0xC0), 0x00};
+  std::vector<char> buffer(100, 0x09);
+  EXPECT_EQ(hsp::find_marker(buffer.data(), buffer.data() + buffer.size(),
+                             marker),
+            buffer.data() + buffer.size());
+  for (size_t pos : {0, 13, 37, 96}) {
+    std::fill(buffer.begin(), buffer.end(), 0x09);
+    std::copy(marker, marker + 4, buffer.begin() + pos);
+    EXPECT_EQ(hsp::find_marker(buffer.data(), buffer.data() + buffer.size(),
+                               marker),
+              buffer.data() + pos);
+  }
+}
+
+namespace {
+
+// test decoder: every pixel of band b is payload size + b
+class SizeDecoder : public AHSIData::FrameDecoder {
+ public:
+  void operator()(const char*, size_t size, AHSIData::Compress,
+                  cv::Mat& out) const override {
+    for (int b = 0; b < out.rows; ++b) {
+      out.row(b).setTo(static_cast<double>(size + b));
+    }
+  }
+};
+
+}  // namespace
+
+TEST(GF501ATest, CompressedFrameDecoder) {
+  const fs::path work_dir = fs::path("/tmp/hsp_unittest/");
+  fs::create_directories(work_dir);
+  const fs::path src_file = work_dir / fs::path("compressed.DAT");
+  const std::vector<size_t> payload_sizes{100, 37, 512};
+  {
+    std::ofstream out(src_file.string(), std::ios::binary);
+    for (size_t k = 0; k < payload_sizes.size(); ++k) {
+      const char header[12] = {0x09, 0x15, static_cast<char>(0xC0), 0x00,
+                               0x00, 0x08, 0x27, 0x01,
+                               0x00, 0x00, 0x00, static_cast<char>(k)};
+      out << std::string(8, '\xAA') << std::string(header, 12)
+          << std::string(payload_sizes[k], '\x55');
+    }
+  }
+
+  AHSIData data(src_file.string());
+  data.set_use_index(false);
+  data.set_decoder(std::make_shared<SizeDecoder>());
+  data.Traverse();
+  EXPECT_EQ(data.compress_mode(), AHSIData::Compress::Lossy8);
+  EXPECT_EQ(data.samples(), 8);
+  EXPECT_EQ(data.bands(), 150);
+  ASSERT_EQ(data.lines(), 3);
+  for (int i = 0; i < data.lines(); ++i) {
+    auto frame = data.GetFrame(i);
+    EXPECT_EQ(frame.index, static_cast<uint32_t>(i));
+    EXPECT_EQ(frame.data.at<uint16_t>(2, 3), payload_sizes[i] + 2);
+  }
+  cv::Mat frames;
+  data.GetFrames(0, 3, frames);
+  for (int i = 0; i < data.lines(); ++i) {
+    EXPECT_EQ(frames.at<uint16_t>(i, 2, 3), payload_sizes[i] + 2);
+  }
+
+  AHSIData no_decoder(src_file.string());
+  no_decoder.set_use_index(false);
+  EXPECT_THROW(no_decoder.Traverse(), std::runtime_error);
+}
+
+TEST(GF501ATest, Resync) {
+  const fs::path work_dir = fs::path("/tmp/hsp_unittest/");
+  fs::create_directories(work_dir);
+  const fs::path src_file = work_dir / fs::path("broken.DAT");
+  // VNIR, 4 samples, direct; frame 2 is dropped, frame 4 is truncated
+  const int n_samples = 4;
+  auto write_frame = [&](std::ofstream& out, int index, int n_bands) {
+    out << std::string(8, '\xAA');
+    for (int b = 0; b < n_bands; ++b) {
+      const char header[12] = {0x09, 0x15, static_cast<char>(0xC0), 0x00,
+                               0x00, n_samples, 0x27, 0x03,
+                               0x00, 0x00, 0x00, static_cast<char>(index)};
+      out << std::string(header, 12);
+      for (int s = 0; s < n_samples; ++s) {
+        const uint16_t value = static_cast<uint16_t>(index * 10 + 1);
+        out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+      }
+    }
+  };
+  {
+    std::ofstream out(src_file.string(), std::ios::binary);
+    for (int index : {0, 1, 3}) {
+      write_frame(out, index, 150);
+    }
+    write_frame(out, 4, 100);
+    for (int index : {5, 6}) {
+      write_frame(out, index, 150);
+    }
+  }
+
+  AHSIData strict(src_file.string());
+  strict.set_use_index(false);
+  strict.Traverse();
+  EXPECT_EQ(strict.lines(), 3);
+
+  AHSIData data(src_file.string(), hsp::ReadMode::Mapped);
+  data.set_use_index(false);
+  data.set_resync(true);
+  data.set_fill_value(7);
+  data.Traverse();
+  ASSERT_EQ(data.lines(), 7);
+  EXPECT_EQ(data.missing_frames(), 2);
+  for (int i = 0; i < data.lines(); ++i) {
+    auto frame = data.GetFrame(i);
+    EXPECT_EQ(frame.index, static_cast<uint32_t>(i));
+    EXPECT_EQ(data.is_missing(i), i == 2 || i == 4);
+    EXPECT_EQ(frame.valid, !data.is_missing(i));
+    EXPECT_EQ(frame.data.at<uint16_t>(149, 3), frame.valid ? i * 10 + 1 : 7);
+  }
+  cv::Mat frames;
+  data.GetFrames(1, 4, frames);
+  EXPECT_EQ(frames.at<uint16_t>(0, 0, 0), 11);
+  EXPECT_EQ(frames.at<uint16_t>(1, 0, 0), 7);
+  EXPECT_EQ(frames.at<uint16_t>(2, 0, 0), 31);
+  EXPECT_EQ(frames.at<uint16_t>(3, 0, 0), 7);
+}
+
+TEST(GF501ATest, CorruptedIndexIsRejected) {
+  const fs::path work_dir = fs::path("/tmp/hsp_unittest/");
+  fs::create_directories(work_dir);
+  const fs::path src_file = work_dir / fs::path("indexed.DAT");
+  const int n_samples = 4;
+  {
+    std::ofstream out(src_file.string(), std::ios::binary);
+    for (int index = 0; index < 2; ++index) {
+      out << std::string(8, '\xAA');
+      for (int b = 0; b < 150; ++b) {
+        const char header[12] = {0x09, 0x15, static_cast<char>(0xC0), 0x00,
+                                 0x00, n_samples, 0x27, 0x03,
+                                 0x00, 0x00, 0x00, static_cast<char>(index)};
+        out << std::string(header, 12)
+            << std::string(n_samples * 2, static_cast<char>(index + 1));
+      }
+    }
+  }
+  AHSIData indexed(src_file.string());
+  indexed.set_use_index(true);
+  indexed.Traverse();
+  ASSERT_EQ(indexed.lines(), 2);
+  ASSERT_TRUE(fs::exists(indexed.index_file()));
+
+  // the offset table (2 x uint64) precedes the frame indices (2 x uint32)
+  {
+    std::fstream index(indexed.index_file(),
+                       std::ios::binary | std::ios::in | std::ios::out);
+    index.seekp(-static_cast<std::streamoff>(2 * 8 + 2 * 4), std::ios::end);
+    const uint64_t offset = fs::file_size(src_file) - 20;
+    index.write(reinterpret_cast<const char*>(&offset), sizeof(offset));
+  }
+  AHSIData reloaded(src_file.string());
+  reloaded.set_use_index(true);
+  reloaded.Traverse();
+  ASSERT_EQ(reloaded.lines(), 2);
+  for (int i = 0; i < 2; ++i) {
+    auto frame = reloaded.GetFrame(i);
+    EXPECT_EQ(frame.index, static_cast<uint32_t>(i));
+    EXPECT_EQ(frame.data.at<uint16_t>(149, 3), (i + 1) * 0x0101);
+  }
+  fs::remove(indexed.index_file());
+}
+
 TEST(GF501ATest, Exception) {
   const fs::path testdata_dir = fs::path(std::getenv("HSP_UNITTEST"));
   const fs::path src_file =
@@ -0,0 +1,134 @@
+// Copyright (C) 2026 Xiao Yunchen
+
+// GTest
+#include <gtest/gtest.h>
+
+// C++ Standard
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Boost
+#include <boost/filesystem.hpp>
+
+// project
+#include "../hsp/decoder/HGYData.hpp"
+#include "../hsp/decoder/SegmentedData.hpp"
+
+namespace fs = boost::filesystem;
+
+class HGYDataTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    fs::create_directories(work_dir);
+    write(src_file, 0, n_lines);
+  }
+
+  // write lines [first, first + count) of the test strip
+  void write(const fs::path& file, int first, int count) const {
+    std::ofstream hdr(file.string() + ".hdr");
+    hdr << "ENVI\n"
+        << "description = {\n  core scanner,\n  SWIR}\n"
+        << "samples = " << n_samples << "\n"
+        << "lines   = " << count << "\n"
+        << "bands   = " << n_bands << "\n"
+        << "header offset = " << header_offset << "\n"
+        << "data type = 12\n"
+        << "interleave = BIL\n"
+        << "byte order = 0\n";
+    std::ofstream dat(file.string(), std::ios::binary);
+    dat << std::string(header_offset, '\0');
+    for (int i = first; i < first + count; ++i) {
+      for (int b = 0; b < n_bands; ++b) {
+        for (int s = 0; s < n_samples; ++s) {
+          const uint16_t value = pixel(i, b, s);
+          dat.write(reinterpret_cast<const char*>(&value), sizeof(value));
+        }
+      }
+    }
+    // trailing partial frame is ignored
+    dat << std::string(5, '\0');
+  }
+
+  static uint16_t pixel(int line, int band, int sample) {
+    return static_cast<uint16_t>(line * 1000 + band * 10 + sample);
+  }
+
+ protected:
+  const fs::path work_dir = fs::path("/tmp/hsp_unittest/");
+  const fs::path src_file = work_dir / fs::path("HGY_SWIR_test.dat");
+  const int n_samples = 7;
+  const int n_lines = 5;
+  const int n_bands = 3;
+  const int header_offset = 16;
+};
+
+TEST_F(HGYDataTest, EnviHeader) {
+  auto header = hsp::read_envi_header(hsp::find_envi_header(src_file.string()));
+  EXPECT_EQ(header.samples, n_samples);
+  EXPECT_EQ(header.lines, n_lines);
+  EXPECT_EQ(header.bands, n_bands);
+  EXPECT_EQ(header.header_offset, 16u);
+  EXPECT_EQ(header.interleave, "bil");
+  EXPECT_EQ(header.fields["description"], "core scanner,\n  SWIR");
+}
+
+TEST_F(HGYDataTest, GetFrame) {
+  for (auto mode : {hsp::ReadMode::Stream, hsp::ReadMode::Mapped}) {
+    hsp::HGYData data(src_file.string(), mode);
+    data.Traverse();
+    EXPECT_EQ(data.samples(), n_samples);
+    EXPECT_EQ(data.bands(), n_bands);
+    ASSERT_EQ(data.lines(), n_lines);
+    for (int i = 0; i < n_lines; ++i) {
+      cv::Mat frame = data.GetFrame(i);
+      ASSERT_EQ(frame.rows, n_bands);
+      ASSERT_EQ(frame.cols, n_samples);
+      EXPECT_EQ(frame.at<uint16_t>(2, 6), pixel(i, 2, 6));
+    }
+    EXPECT_THROW(data.GetFrame(n_lines), std::out_of_range);
+  }
+}
+
+TEST_F(HGYDataTest, GetFrames) {
+  for (auto mode : {hsp::ReadMode::Stream, hsp::ReadMode::Mapped}) {
+    hsp::HGYData data(src_file.string(), mode);
+    data.Traverse();
+    cv::Mat frames;
+    data.GetFrames(1, 3, frames);
+    ASSERT_EQ(frames.size[0], 3);
+    for (int k = 0; k < 3; ++k) {
+      EXPECT_EQ(frames.at<uint16_t>(k, 1, 4), pixel(k + 1, 1, 4));
+    }
+  }
+}
+
+TEST_F(HGYDataTest, FrameIterator) {
+  hsp::HGYData data(src_file.string());
+  data.Traverse();
+  int i = 0;
+  for (auto&& frame : data) {
+    EXPECT_EQ(frame.at<uint16_t>(0, 0), pixel(i++, 0, 0));
+  }
+  EXPECT_EQ(i, n_lines);
+}
+
+TEST_F(HGYDataTest, Segments) {
+  const fs::path segment_file = work_dir / fs::path("HGY_SWIR_test_2.dat");
+  write(segment_file, n_lines, 4);
+  hsp::SegmentedData<hsp::HGYData> data(
+      {src_file.string(), segment_file.string()});
+  data.Traverse();
+  EXPECT_EQ(data.n_segments(), 2);
+  EXPECT_EQ(data.segment_start(1), n_lines);
+  ASSERT_EQ(data.lines(), n_lines + 4);
+  for (int i = 0; i < data.lines(); ++i) {
+    EXPECT_EQ(data.GetFrame(i).at<uint16_t>(1, 2), pixel(i, 1, 2));
+  }
+  cv::Mat frames;
+  data.GetFrames(n_lines - 2, 4, frames);
+  for (int k = 0; k < 4; ++k) {
+    EXPECT_EQ(frames.at<uint16_t>(k, 2, 3), pixel(n_lines - 2 + k, 2, 3));
+  }
+}
@@ -0,0 +1,97 @@
+// Copyright (C) 2026 Xiao Yunchen
+
+// GTest
+#include <gtest/gtest.h>
+
+// C++ Standard
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+
+// project
+#include "../hsp/concurrency.hpp"
+
+TEST(SPSCRingTest, PushPop) {
+  hsp::SPSCRing<int> ring(2);
+  EXPECT_EQ(ring.capacity(), 2u);
+  EXPECT_TRUE(ring.empty());
+  int value = 1;
+  EXPECT_TRUE(ring.try_push(value));
+  value = 2;
+  EXPECT_TRUE(ring.try_push(value));
+  value = 3;
+  EXPECT_FALSE(ring.try_push(value));
+  EXPECT_EQ(ring.pop(), 1);
+  EXPECT_EQ(ring.pop(), 2);
+  EXPECT_FALSE(ring.try_pop(value));
+  EXPECT_EQ(value, 3);
+}
+
+TEST(SPSCRingTest, ProducerConsumerKeepOrder) {
+  const int n = 100000;
+  hsp::SPSCRing<int> ring(16);
+  std::thread producer([&ring] {
+    for (int i = 0; i < n; ++i) {
+      ring.push(i);
+    }
+  });
+  int expected = 0;
+  for (int i = 0; i < n; ++i) {
+    if (ring.pop() != expected++) {
+      break;
+    }
+  }
+  producer.join();
+  EXPECT_EQ(expected, n);
+  EXPECT_TRUE(ring.empty());
+}
+
+TEST(PrefetcherTest, KeepOrder) {
+  hsp::Prefetcher<int> prefetcher(3, 1000, 4, [](int i) { return i * 2; });
+  for (int i = 3; i < 1000; ++i) {
+    ASSERT_EQ(prefetcher.pop(), i * 2);
+  }
+}
+
+namespace {
+
+// like hsp::AHSIFrame, not default-constructible
+struct Frame {
+  Frame() = delete;
+  explicit Frame(int i) : index{i} {}
+  int index;
+};
+
+}  // namespace
+
+TEST(PrefetcherTest, NonDefaultConstructible) {
+  hsp::Prefetcher<Frame> prefetcher(0, 100, 4, [](int i) { return Frame(i); });
+  for (int i = 0; i < 100; ++i) {
+    ASSERT_EQ(prefetcher.pop().index, i);
+  }
+}
+
+TEST(PrefetcherTest, RethrowInOrder) {
+  hsp::Prefetcher<int> prefetcher(0, 10, 2, [](int i) {
+    if (i == 5) {
+      throw std::runtime_error("failed");
+    }
+    return i;
+  });
+  for (int i = 0; i < 5; ++i) {
+    EXPECT_EQ(prefetcher.pop(), i);
+  }
+  EXPECT_THROW(prefetcher.pop(), std::runtime_error);
+}
+
+TEST(PrefetcherTest, StopEarly) {
+  std::atomic<int> produced{0};
+  {
+    hsp::Prefetcher<int> prefetcher(0, 1000000, 4, [&](int i) {
+      ++produced;
+      return i;
+    });
+    EXPECT_EQ(prefetcher.pop(), 0);
+  }
+  EXPECT_LT(produced.load(), 1000000);
+}
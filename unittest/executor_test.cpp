@@ -0,0 +1,93 @@
+// Copyright (C) 2026 Xiao Yunchen
+
+// GTest
+#include <gtest/gtest.h>
+
+// C++ Standard
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+// Boost
+#include <boost/iterator/function_output_iterator.hpp>
+
+// OpenCV
+#include <opencv2/core.hpp>
+
+// project
+#include "../hsp/algorithm/radiometric.hpp"
+#include "../hsp/executor.hpp"
+
+namespace {
+
+std::vector<cv::Mat> make_lines(int n) {
+  std::vector<cv::Mat> lines;
+  for (int i = 0; i < n; ++i) {
+    lines.emplace_back(4, 16, CV_16U, cv::Scalar::all(i));
+  }
+  return lines;
+}
+
+// results are cloned because the executor reuses its output buffers
+auto collect(std::vector<cv::Mat>& results) {
+  return boost::make_function_output_iterator(
+      [&results](const cv::Mat& m) { results.push_back(m.clone()); });
+}
+
+}  // namespace
+
+TEST(ExecutorTest, OrderedTransformKeepsOrder) {
+  const auto lines = make_lines(200);
+  std::vector<cv::Mat> results;
+  hsp::ordered_transform(
+      lines.begin(), lines.end(), collect(results),
+      [](const cv::Mat& m) {
+        // uneven work so that lines finish out of order
+        const int v = m.at<uint16_t>(0, 0);
+        std::this_thread::sleep_for(std::chrono::microseconds(v % 7 * 100));
+        cv::Mat res = m + 1;
+        return res;
+      },
+      4, 3);
+  ASSERT_EQ(results.size(), lines.size());
+  for (std::size_t i = 0; i < results.size(); ++i) {
+    EXPECT_EQ(cv::norm(results[i], lines[i] + 1, cv::NORM_INF), 0) << i;
+  }
+}
+
+TEST(ExecutorTest, OrderedTransformEqualsTransform) {
+  auto lines = make_lines(64);
+  for (auto&& line : lines) {
+    cv::randu(line, 0, 4096);
+  }
+  hsp::UnaryOpCombo ops;
+  ops.add(hsp::make_op<hsp::GaussianFilter>());
+  std::vector<cv::Mat> expected, results;
+  std::transform(lines.begin(), lines.end(), std::back_inserter(expected),
+                 ops);
+  hsp::ordered_transform(lines.begin(), lines.end(), collect(results), ops, 8);
+  ASSERT_EQ(results.size(), expected.size());
+  for (std::size_t i = 0; i < results.size(); ++i) {
+    EXPECT_EQ(cv::norm(results[i], expected[i], cv::NORM_INF), 0) << i;
+  }
+}
+
+TEST(ExecutorTest, OrderedTransformRethrows) {
+  const auto lines = make_lines(100);
+  std::vector<cv::Mat> results;
+  EXPECT_THROW(hsp::ordered_transform(
+                   lines.begin(), lines.end(), collect(results),
+                   [](const cv::Mat& m) {
+                     if (m.at<uint16_t>(0, 0) == 50) {
+                       throw std::runtime_error("bad line");
+                     }
+                     return m;
+                   },
+                   4),
+               std::runtime_error);
+  // lines before the failing one are still written, in order
+  ASSERT_EQ(results.size(), 50u);
+  EXPECT_EQ(results.back().at<uint16_t>(0, 0), 49);
+}
@@ -0,0 +1,105 @@
+// Copyright (C) 2026 Xiao Yunchen
+
+// GTest
+#include <gtest/gtest.h>
+
+// C++ Standard
+#include <string>
+#include <utility>
+#include <vector>
+
+// Boost
+#include <boost/filesystem.hpp>
+
+// project
+#include "../hsp/iterator.hpp"
+
+namespace {
+
+std::string find_option(
+    const std::vector<std::pair<std::string, std::string>>& options,
+    const std::string& key) {
+  for (auto&& option : options) {
+    if (option.first == key) {
+      return option.second;
+    }
+  }
+  return "";
+}
+
+}  // namespace
+
+TEST(IOConfigTest, CreationOptions) {
+  hsp::gdal::IOConfig io;
+  EXPECT_TRUE(io.creation_options("GTiff").empty());
+
+  io.block_x = 256;
+  io.block_y = 128;
+  io.interleave = "bip";
+  io.compress = "LZW";
+  io.options["COMPRESS"] = "DEFLATE";
+  auto tiff = io.creation_options("GTiff");
+  EXPECT_EQ(find_option(tiff, "TILED"), "YES");
+  EXPECT_EQ(find_option(tiff, "BLOCKXSIZE"), "256");
+  EXPECT_EQ(find_option(tiff, "BLOCKYSIZE"), "128");
+  EXPECT_EQ(find_option(tiff, "INTERLEAVE"), "PIXEL");
+  EXPECT_EQ(find_option(tiff, "COMPRESS"), "DEFLATE");
+  auto envi = io.creation_options("ENVI");
+  EXPECT_EQ(find_option(envi, "INTERLEAVE"), "BIP");
+  EXPECT_EQ(find_option(envi, "BLOCKXSIZE"), "");
+  EXPECT_EQ(find_option(envi, "BLOCKYSIZE"), "");
+
+  io.interleave = "BIL";
+  EXPECT_THROW(io.creation_options("GTiff"), std::invalid_argument);
+}
+
+TEST(IOConfigTest, ApplyAndDescribe) {
+  GDALAllRegister();
+  const GIntBig cache_max = GDALGetCacheMax64();
+  hsp::gdal::IOConfig io;
+  io.cache_max_mb = 64;
+  io.num_threads = 2;
+  io.advise_read = 8;
+  io.apply();
+  EXPECT_EQ(GDALGetCacheMax64(), 64ll << 20);
+  EXPECT_STREQ(CPLGetConfigOption("GDAL_NUM_THREADS", ""), "2");
+  const std::string log = io.describe();
+  EXPECT_NE(log.find("GDAL_CACHEMAX=64MB"), std::string::npos);
+  EXPECT_NE(log.find("GDAL_NUM_THREADS=2"), std::string::npos);
+  EXPECT_NE(log.find("advise_read=8"), std::string::npos);
+  CPLSetConfigOption("GDAL_NUM_THREADS", nullptr);
+  GDALSetCacheMax64(cache_max);
+}
+
+TEST(IOConfigTest, IteratorsAcceptConfig) {
+  GDALAllRegister();
+  namespace fs = boost::filesystem;
+  fs::create_directories("/tmp/hsp_unittest/");
+  const std::string file = "/tmp/hsp_unittest/io_config_test.tif";
+  hsp::gdal::IOConfig io;
+  io.block_x = io.block_y = 16;
+  io.advise_read = 4;
+  io.prefetch = 2;
+  io.write_queue = 2;
+  auto dataset = GDALDatasetUniquePtr(
+      hsp::gdal::GDALCreate(file.c_str(), 40, 30, 3, GDT_UInt16, io));
+  ASSERT_NE(nullptr, dataset);
+  int block_x = 0, block_y = 0;
+  dataset->GetRasterBand(1)->GetBlockSize(&block_x, &block_y);
+  EXPECT_EQ(block_x, 16);
+  EXPECT_EQ(block_y, 16);
+
+  hsp::LineOutputIterator<uint16_t> out(dataset.get(), 0, io);
+  for (int i = 0; i < 30; ++i) {
+    *out++ = cv::Mat(3, 40, CV_16U, cv::Scalar(i));
+  }
+  out.close();
+
+  hsp::LineInputIterator<uint16_t> it(dataset.get(), 0, io),
+      end(dataset.get());
+  int i = 0;
+  for (; it != end; ++it, ++i) {
+    EXPECT_EQ((*it).at<uint16_t>(2, 39), i);
+  }
+  EXPECT_EQ(i, 30);
+}
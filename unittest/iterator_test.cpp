@@ -4,7 +4,11 @@
 #include <gtest/gtest.h>
 
 // C++ Standard
+#include <algorithm>
 #include <fstream>
+#include <iterator>
+#include <type_traits>
+#include <vector>
 
 // Boost
 #include <boost/filesystem.hpp>
@@ -13,6 +17,8 @@
 #include "../hsp/algorithm/cuda.hpp"
 #include "../hsp/algorithm/radiometric.hpp"
 #include "../hsp/core.hpp"
+#include "../hsp/interleave.hpp"
+#include "../hsp/partition.hpp"
 
 namespace fs = boost::filesystem;
 
@@ -275,3 +281,320 @@ TEST_F(IteratorTest, BandIteratorCopy) {
   EXPECT_TRUE(filecmp(src_file.string(), dst_file.string()))
       << "Destination file is not identical with source.";
 }
+
+TEST_F(IteratorTest, TileIteratorCopy) {
+  hsp::TileInputIterator<float> beg(src_dataset.get(), 0),
+      end(src_dataset.get());
+  CreateDst();
+  hsp::TileOutputIterator<float> obeg(dst_dataset, 0, beg.tile_size());
+  std::copy(beg, end, obeg);
+  GDALClose(dst_dataset);
+  EXPECT_TRUE(filecmp(src_file.string(), dst_file.string()))
+      << "Destination file is not identical with source.";
+}
+
+TEST_F(IteratorTest, TileIteratorCoversImage) {
+  const cv::Size tile_size(7, 5);
+  hsp::TileInputIterator<float> it(src_dataset.get(), 0, tile_size),
+      end(src_dataset.get(), tile_size);
+  int pixels = 0;
+  for (; it != end; ++it) {
+    const cv::Rect r = it.rect();
+    ASSERT_EQ(it->dims, 3);
+    EXPECT_EQ(it->size[0], r.height);
+    EXPECT_EQ(it->size[1], n_bands);
+    EXPECT_EQ(it->size[2], r.width);
+    pixels += r.area();
+  }
+  EXPECT_EQ(pixels, n_samples * n_lines);
+}
+
+TEST_F(IteratorTest, TileOutputIteratorRejectsType) {
+  hsp::TileInputIterator<float> it(src_dataset.get(), 0);
+  CreateDst();
+  hsp::TileOutputIterator<uint16_t> obeg(dst_dataset, 0, it.tile_size());
+  EXPECT_THROW(*obeg = *it, std::invalid_argument);
+  GDALClose(dst_dataset);
+}
+
+TEST_F(IteratorTest, ChunkIteratorCopy) {
+  const int lines_per_chunk = 16;
+  hsp::ChunkInputIterator<float> beg(src_dataset.get(), 0, lines_per_chunk),
+      end(src_dataset.get(), lines_per_chunk);
+  CreateDst();
+  hsp::ChunkOutputIterator<float> obeg(dst_dataset, 0, lines_per_chunk);
+  std::copy(beg, end, obeg);
+  GDALClose(dst_dataset);
+  EXPECT_TRUE(filecmp(src_file.string(), dst_file.string()))
+      << "Destination file is not identical with source.";
+}
+
+TEST_F(IteratorTest, ChunkOutlivesShortLastChunk) {
+  // a chunk height that leaves a shorter last chunk
+  int lines_per_chunk = 16;
+  while (n_lines % lines_per_chunk == 0) {
+    ++lines_per_chunk;
+  }
+  ASSERT_GT(n_lines, lines_per_chunk);
+  const int n_chunks = (n_lines + lines_per_chunk - 1) / lines_per_chunk;
+  cv::Mat kept;
+  {
+    hsp::ChunkInputIterator<float> it(src_dataset.get(), n_chunks - 2,
+                                      lines_per_chunk),
+        end(src_dataset.get(), lines_per_chunk);
+    kept = *it;
+    ++it;
+    ASSERT_LT(it->rows, kept.rows);
+    ++it;
+    ASSERT_TRUE(it == end);
+  }
+  const int first = (n_chunks - 2) * lines_per_chunk;
+  hsp::LineInputIterator<float> line(src_dataset.get(), first);
+  for (int k = 0; k < lines_per_chunk; ++k, ++line) {
+    EXPECT_EQ(cv::norm(kept.rowRange(k * n_bands, (k + 1) * n_bands), *line,
+                       cv::NORM_INF),
+              0)
+        << first + k;
+  }
+}
+
+TEST_F(IteratorTest, ChunkOutputIteratorRejectsType) {
+  hsp::ChunkInputIterator<float> it(src_dataset.get(), 0, 16);
+  CreateDst();
+  hsp::ChunkOutputIterator<uint16_t> obeg(dst_dataset, 0, 16);
+  EXPECT_THROW(*obeg = *it, std::invalid_argument);
+  EXPECT_THROW(hsp::ChunkOutputIterator<float>(dst_dataset, 0, 0),
+               std::invalid_argument);
+  GDALClose(dst_dataset);
+}
+
+TEST_F(IteratorTest, LineIteratorCopyWithPrefetch) {
+  hsp::LineInputIterator<float> beg(src_dataset.get(), 0, 4),
+      end(src_dataset.get());
+  CreateDst();
+  hsp::LineOutputIterator<float> obeg(dst_dataset, 0);
+  std::copy(beg, end, obeg);
+  GDALClose(dst_dataset);
+  EXPECT_TRUE(filecmp(src_file.string(), dst_file.string()))
+      << "Destination file is not identical with source.";
+}
+
+TEST_F(IteratorTest, PrefetchedLinesStayValid) {
+  std::vector<cv::Mat> lines;
+  {
+    hsp::LineInputIterator<float> it(src_dataset.get(), 0, 4);
+    for (int i = 0; i < std::min(n_lines, 8); ++i, ++it) {
+      lines.push_back(*it);
+    }
+  }
+  // the prefetching thread is gone, the dataset can be read again
+  hsp::LineInputIterator<float> reference(src_dataset.get(), 0);
+  for (auto&& line : lines) {
+    EXPECT_EQ(cv::norm(line, *reference, cv::NORM_INF), 0);
+    ++reference;
+  }
+}
+
+TEST_F(IteratorTest, LineIteratorCopyWriteBehind) {
+  hsp::LineInputIterator<float> beg(src_dataset.get(), 0),
+      end(src_dataset.get());
+  CreateDst();
+  hsp::LineOutputIterator<float> obeg(dst_dataset, 0, 4, 7);
+  obeg = std::copy(beg, end, obeg);
+  EXPECT_NO_THROW(obeg.close());
+  GDALClose(dst_dataset);
+  EXPECT_TRUE(filecmp(src_file.string(), dst_file.string()))
+      << "Destination file is not identical with source.";
+}
+
+TEST_F(IteratorTest, SampleIteratorCopyWriteBehind) {
+  hsp::SampleInputIterator<float> beg(src_dataset.get(), 0),
+      end(src_dataset.get());
+  CreateDst();
+  hsp::SampleOutputIterator<float> obeg(dst_dataset, 0, 4);
+  obeg = std::copy(beg, end, obeg);
+  EXPECT_NO_THROW(obeg.close());
+  GDALClose(dst_dataset);
+  EXPECT_TRUE(filecmp(src_file.string(), dst_file.string()))
+      << "Destination file is not identical with source.";
+}
+
+TEST_F(IteratorTest, BandIteratorCopyWriteBehind) {
+  hsp::BandInputIterator<float> beg(src_dataset.get(), 0),
+      end(src_dataset.get());
+  CreateDst();
+  hsp::BandOutputIterator<float> obeg(dst_dataset, 0, 2);
+  obeg = std::copy(beg, end, obeg);
+  EXPECT_NO_THROW(obeg.close());
+  GDALClose(dst_dataset);
+  EXPECT_TRUE(filecmp(src_file.string(), dst_file.string()))
+      << "Destination file is not identical with source.";
+}
+
+TEST_F(IteratorTest, WriteBehindRejectsWrongType) {
+  CreateDst();
+  hsp::LineOutputIterator<float> obeg(dst_dataset, 0, 4);
+  cv::Mat line = cv::Mat::zeros(n_bands, n_samples, CV_16U);
+  EXPECT_THROW(*obeg = line, std::invalid_argument);
+  obeg.close();
+  GDALClose(dst_dataset);
+}
+
+TEST_F(IteratorTest, SampleCacheEqualsSampleIterator) {
+  for (auto storage : {hsp::CacheStorage::Memory, hsp::CacheStorage::Mapped}) {
+    hsp::SampleCache<float> cache(src_dataset.get(), storage, 7);
+    ASSERT_EQ(cache.samples(), n_samples);
+    hsp::SampleInputIterator<float> it(src_dataset.get(), 0);
+    for (int x = 0; x < n_samples; ++x, ++it) {
+      EXPECT_EQ(cv::norm(cache.sample(x), *it, cv::NORM_INF), 0.0);
+    }
+  }
+}
+
+TEST_F(IteratorTest, SampleCacheCopy) {
+  hsp::SampleCache<float> cache(src_dataset.get(), hsp::CacheStorage::Mapped);
+  CreateDst();
+  hsp::SampleOutputIterator<float> obeg(dst_dataset, 0);
+  std::copy(cache.begin(), cache.end(), obeg);
+  GDALClose(dst_dataset);
+  EXPECT_TRUE(filecmp(src_file.string(), dst_file.string()))
+      << "Destination file is not identical with source.";
+}
+
+TEST_F(IteratorTest, SampleCacheRemovesScratchOnFailure) {
+  const fs::path scratch_dir = work_dir / fs::path("scratch");
+  fs::remove_all(scratch_dir);
+  fs::create_directory(scratch_dir);
+  // 2^63 bytes: no file system can hold it, so resizing the scratch file
+  // fails right after the file is created
+  auto driver = GetGDALDriverManager()->GetDriverByName("VRT");
+  ASSERT_NE(nullptr, driver);
+  GDALDatasetUniquePtr huge(
+      driver->Create("", 1 << 30, 1 << 30, 1, GDT_Float64, nullptr));
+  ASSERT_NE(nullptr, huge);
+  EXPECT_ANY_THROW(hsp::SampleCache<double>(
+      huge.get(), hsp::CacheStorage::Mapped, 64, scratch_dir.string()));
+  EXPECT_TRUE(fs::is_empty(scratch_dir));
+  fs::remove_all(scratch_dir);
+}
+
+TEST_F(IteratorTest, ConvertInterleaveRoundTrip) {
+  const fs::path bil_file = work_dir / fs::path("interleave_test.bil");
+  const fs::path bip_file = work_dir / fs::path("interleave_test.bip");
+  // a few lines per chunk, so that the conversion runs in several chunks
+  const std::size_t max_memory =
+      3 * n_samples * n_bands * GDALGetDataTypeSizeBytes(type);
+  src_dataset.reset();
+  hsp::convert_interleave(src_file.string(), bil_file.string(),
+                          hsp::Interleave::BIL, max_memory);
+  hsp::convert_interleave(bil_file.string(), bip_file.string(),
+                          hsp::Interleave::BIP, max_memory);
+  hsp::convert_interleave(bip_file.string(), dst_file.string(),
+                          hsp::Interleave::BSQ, max_memory);
+  EXPECT_TRUE(filecmp(src_file.string(), dst_file.string()))
+      << "Destination file is not identical with source.";
+
+  auto bil_dataset = GDALDatasetUniquePtr(GDALDataset::FromHandle(
+      GDALOpen(bil_file.string().c_str(), GA_ReadOnly)));
+  ASSERT_NE(nullptr, bil_dataset);
+  EXPECT_EQ(hsp::interleave_of(bil_dataset.get()), hsp::Interleave::BIL);
+}
+
+TEST_F(IteratorTest, ParseInterleave) {
+  EXPECT_EQ(hsp::parse_interleave("bil"), hsp::Interleave::BIL);
+  EXPECT_EQ(hsp::parse_interleave("PIXEL"), hsp::Interleave::BIP);
+  EXPECT_EQ(hsp::parse_interleave("Band"), hsp::Interleave::BSQ);
+  EXPECT_THROW(hsp::parse_interleave("tiled"), std::invalid_argument);
+}
+
+TEST_F(IteratorTest, RandomAccessLineIterator) {
+  // random access for boost, only an input iterator for the standard library,
+  // since dereferencing returns by value
+  using Iterator = hsp::RandomLineInputIterator<float>;
+  static_assert(std::is_convertible<boost::iterator_traversal<Iterator>::type,
+                                    boost::random_access_traversal_tag>::value,
+                "random access traversal");
+  static_assert(
+      std::is_convertible<std::iterator_traits<Iterator>::iterator_category,
+                          std::input_iterator_tag>::value &&
+          !std::is_convertible<
+              std::iterator_traits<Iterator>::iterator_category,
+              std::forward_iterator_tag>::value,
+      "input iterator category");
+
+  hsp::RandomLineInputIterator<float> beg(src_dataset.get(), 0),
+      end(src_dataset.get(), n_lines);
+  EXPECT_EQ(end - beg, n_lines);
+  EXPECT_EQ(std::distance(beg, end), n_lines);
+  EXPECT_THROW(*Iterator(), std::runtime_error);
+  hsp::LineInputIterator<float> it(src_dataset.get(), n_lines - 1);
+  EXPECT_EQ(cv::norm(*(end - 1), *it, cv::NORM_INF), 0.0);
+  EXPECT_TRUE(beg < end);
+  EXPECT_THROW(*end, std::out_of_range);
+
+  CreateDst();
+  hsp::LineOutputIterator<float> obeg(dst_dataset, 0);
+  std::copy(beg, end, obeg);
+  GDALClose(dst_dataset);
+  EXPECT_TRUE(filecmp(src_file.string(), dst_file.string()))
+      << "Destination file is not identical with source.";
+}
+
+TEST_F(IteratorTest, PartitionRange) {
+  auto ranges = hsp::partition_range(10, 3);
+  ASSERT_EQ(ranges.size(), 3u);
+  EXPECT_EQ(ranges[0].start, 0);
+  EXPECT_EQ(ranges[2].end, 10);
+  for (size_t k = 1; k < ranges.size(); ++k) {
+    EXPECT_EQ(ranges[k].start, ranges[k - 1].end);
+    EXPECT_LE(std::abs(ranges[k].size() - ranges[0].size()), 1);
+  }
+  EXPECT_EQ(hsp::partition_range(2, 8).size(), 2u);
+}
+
+TEST_F(IteratorTest, ParallelTransformCopy) {
+  CreateDst();
+  hsp::parallel_transform<2, float>(
+      src_file.string(), dst_dataset, [](const cv::Mat& m) { return m; }, 4);
+  GDALClose(dst_dataset);
+  EXPECT_TRUE(filecmp(src_file.string(), dst_file.string()))
+      << "Destination file is not identical with source.";
+}
+
+TEST_F(IteratorTest, ParallelPartitionRethrows) {
+  EXPECT_THROW(hsp::parallel_partition<3>(
+                   src_file.string(),
+                   [](GDALDataset*, const cv::Range& range) {
+                     if (range.start > 0) {
+                       throw std::runtime_error("failed part");
+                     }
+                   },
+                   2),
+               std::runtime_error);
+}
+
+TEST_F(IteratorTest, NativeIteratorCopy) {
+  CreateDst();
+  const int n = hsp::with_native_iterators<2>(
+      src_dataset.get(), [&](auto beg, auto end) {
+        using T = typename decltype(beg)::pixel_type;
+        EXPECT_EQ(hsp::gdal::DataType<T>::type(), type);
+        hsp::LineOutputIterator<T> obeg(dst_dataset, 0);
+        std::copy(beg, end, obeg);
+        return n_lines;
+      });
+  EXPECT_EQ(n, n_lines);
+  GDALClose(dst_dataset);
+  EXPECT_TRUE(filecmp(src_file.string(), dst_file.string()))
+      << "Destination file is not identical with source.";
+}
+
+TEST(GDALTraitsTest, VisitDataType) {
+  auto size = [](auto tag) {
+    return static_cast<int>(sizeof(typename decltype(tag)::type));
+  };
+  EXPECT_EQ(hsp::gdal::visit_data_type(GDT_UInt16, size), 2);
+  EXPECT_EQ(hsp::gdal::visit_data_type(GDT_Float64, size), 8);
+  EXPECT_THROW(hsp::gdal::visit_data_type(GDT_CFloat32, size),
+               std::invalid_argument);
+}
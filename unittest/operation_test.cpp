@@ -102,6 +102,153 @@ TEST_F(OperationTest, DarkBackgroundCorrection) {
   EXPECT_FALSE(filecmp(src_file.string(), dst_file.string()));
 }
 
+TEST_F(OperationTest, ChunkedOpsEqualLineOps) {
+  auto dbc = hsp::make_op<hsp::DarkBackgroundCorrection<uint16_t> >();
+  dbc->load(dark_coeff.string());
+  auto nuc = hsp::make_op<hsp::NonUniformityCorrection<uint16_t, float> >();
+  nuc->load(rel_a_coeff.string(), rel_b_coeff.string());
+  hsp::UnaryOpCombo ops;
+  ops.add(dbc).add(nuc).add(hsp::per_line(hsp::make_op<hsp::GaussianFilter>(),
+                                          n_bands));
+
+  const int lines_per_chunk = 8;
+  hsp::ChunkInputIterator<uint16_t> chunk(src_dataset.get(), 0,
+                                          lines_per_chunk),
+      chunk_end(src_dataset.get(), lines_per_chunk);
+  hsp::LineInputIterator<uint16_t> line(src_dataset.get(), 0);
+  for (; chunk != chunk_end; ++chunk) {
+    cv::Mat res = ops(*chunk);
+    for (int r = 0; r < res.rows; r += n_bands, ++line) {
+      cv::Mat expected = ops(*line);
+      EXPECT_EQ(cv::norm(res.rowRange(r, r + n_bands), expected,
+                         cv::NORM_INF),
+                0);
+    }
+  }
+}
+
+// the accepted tolerance of fusion: at most 1 DN for integer outputs
+TEST_F(OperationTest, FusedAffineEqualsSequential) {
+  auto dbc = hsp::make_op<hsp::DarkBackgroundCorrection<uint16_t> >();
+  dbc->load(dark_coeff.string());
+  auto etalon = hsp::make_op<hsp::NonUniformityCorrection<double, double> >();
+  etalon->load(rel_a_coeff.string(), rel_b_coeff.string());
+  auto nuc_f = hsp::make_op<hsp::NonUniformityCorrection<uint16_t, float> >();
+  nuc_f->load(rel_a_coeff.string(), rel_b_coeff.string());
+  // the chain of img_process() in samples/main.cpp
+  auto nuc_d = hsp::make_op<hsp::NonUniformityCorrection<uint16_t, double> >();
+  nuc_d->load(rel_a_coeff.string(), rel_b_coeff.string());
+
+  for (hsp::unary_op nuc : {hsp::unary_op(nuc_f), hsp::unary_op(nuc_d)}) {
+    hsp::UnaryOpCombo fused, sequential;
+    fused.set_fusion(true).add(dbc).add(etalon).add(nuc);
+    sequential.add(dbc).add(etalon).add(nuc);
+
+    const int lines_per_chunk = 8;
+    hsp::ChunkInputIterator<uint16_t> chunk(src_dataset.get(), 0,
+                                            lines_per_chunk),
+        chunk_end(src_dataset.get(), lines_per_chunk);
+    for (; chunk != chunk_end; ++chunk) {
+      cv::Mat res = fused(*chunk);
+      cv::Mat expected = sequential(*chunk);
+      ASSERT_EQ(res.type(), expected.type());
+      EXPECT_LE(cv::norm(res, expected, cv::NORM_INF), 1);
+    }
+  }
+}
+
+TEST_F(OperationTest, FusedAffineFollowsReload) {
+  auto dbc = hsp::make_op<hsp::DarkBackgroundCorrection<uint16_t> >();
+  dbc->load(dark_coeff.string());
+  auto nuc = hsp::make_op<hsp::NonUniformityCorrection<double, double> >();
+  nuc->load(rel_a_coeff.string(), rel_b_coeff.string());
+  hsp::UnaryOpCombo fused, sequential;
+  fused.set_fusion(true).add(dbc).add(nuc);
+  sequential.add(dbc).add(nuc);
+
+  const cv::Mat line = *hsp::LineInputIterator<uint16_t>(src_dataset.get(), 0);
+  fused(line);  // folds and caches the coefficients
+  nuc->load(rel_b_coeff.string(), rel_a_coeff.string());
+  const cv::Mat expected = sequential(line);
+  EXPECT_LE(cv::norm(fused(line), expected, cv::NORM_INF | cv::NORM_RELATIVE),
+            1e-9);
+}
+
+TEST_F(OperationTest, PipelineEqualsCombo) {
+  auto dbc = hsp::make_op<hsp::DarkBackgroundCorrection<uint16_t> >();
+  dbc->load(dark_coeff.string());
+  auto nuc = hsp::make_op<hsp::NonUniformityCorrection<uint16_t, float> >();
+  nuc->load(rel_a_coeff.string(), rel_b_coeff.string());
+  hsp::UnaryOpCombo combo;
+  combo.add(dbc).add(nuc);
+  auto ops = hsp::pipeline(dbc, nuc);
+
+  hsp::LineInputIterator<uint16_t> beg(src_dataset.get(), 0),
+      end(src_dataset.get());
+  for (auto it = beg; it != end; ++it) {
+    cv::Mat res = ops(*it);
+    cv::Mat expected = combo(*it);
+    ASSERT_EQ(res.type(), expected.type());
+    EXPECT_LE(cv::norm(res, expected, cv::NORM_INF), 1);
+  }
+}
+
+TEST(PipelineTest, Clamp) {
+  cv::Mat m(4, 16, CV_16U);
+  cv::randu(m, 0, 1000);
+  auto ops = hsp::pipeline(hsp::pixel::clamp<uint8_t>(10, 200));
+  cv::Mat res = ops(m);
+  ASSERT_EQ(res.type(), CV_8U);
+  for (int r = 0; r < m.rows; ++r) {
+    for (int i = 0; i < m.cols; ++i) {
+      const int v = m.at<uint16_t>(r, i);
+      EXPECT_EQ(res.at<uint8_t>(r, i), std::min(std::max(v, 10), 200));
+    }
+  }
+}
+
+TEST_F(OperationTest, ApplyReusesOutput) {
+  auto dbc = hsp::make_op<hsp::DarkBackgroundCorrection<uint16_t> >();
+  dbc->load(dark_coeff.string());
+  auto nuc = hsp::make_op<hsp::NonUniformityCorrection<uint16_t, float> >();
+  nuc->load(rel_a_coeff.string(), rel_b_coeff.string());
+  hsp::UnaryOpCombo ops;
+  ops.add(dbc).add(nuc).add(hsp::make_op<hsp::GaussianFilter>());
+
+  hsp::LineInputIterator<uint16_t> beg(src_dataset.get(), 0),
+      end(src_dataset.get());
+  cv::Mat out;
+  const uchar* data = nullptr;
+  for (auto it = beg; it != end; ++it) {
+    ops.apply(*it, out);
+    if (!data) {
+      data = out.data;
+    }
+    EXPECT_EQ(out.data, data);
+    EXPECT_EQ(cv::norm(out, ops(*it), cv::NORM_INF), 0);
+  }
+}
+
+namespace {
+
+// returns its input, like an operation that leaves some lines untouched
+class Identity : public hsp::UnaryOperation<cv::Mat> {
+ public:
+  cv::Mat operator()(cv::Mat m) const override { return m; }
+};
+
+}  // namespace
+
+TEST(UnaryOperationTest, ApplyDoesNotAliasInput) {
+  cv::Mat in(4, 16, CV_16U, cv::Scalar::all(3));
+  cv::Mat out;
+  Identity().apply(in, out);
+  EXPECT_NE(out.data, in.data);
+  EXPECT_EQ(cv::norm(out, in, cv::NORM_INF), 0);
+  Identity().apply(in.rowRange(1, 3), out);
+  EXPECT_NE(out.data, in.ptr(1));
+}
+
 TEST(DPCTest, FindConsecutive) {
   GDALAllRegister();
   const fs::path testdata_dir = fs::path(std::getenv("HSP_UNITTEST"));
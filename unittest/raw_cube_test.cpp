@@ -0,0 +1,175 @@
+// Copyright (C) 2026 Xiao Yunchen
+
+// GTest
+#include <gtest/gtest.h>
+
+// C++ Standard
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <tuple>
+#include <type_traits>
+
+// Boost
+#include <boost/filesystem.hpp>
+
+// project
+#include "../hsp/envi.hpp"
+#include "../hsp/iterator.hpp"
+#include "../hsp/raw_cube.hpp"
+
+namespace {
+
+namespace fs = boost::filesystem;
+
+const int kSamples = 7;
+const int kLines = 5;
+const int kBands = 3;
+
+uint16_t pixel(int line, int band, int sample) {
+  return static_cast<uint16_t>(line * 1000 + band * 10 + sample);
+}
+
+class RawCubeTest
+    : public ::testing::TestWithParam<std::tuple<hsp::Interleave, hsp::RawIO>> {
+ protected:
+  void SetUp() override {
+    fs::create_directories(work_dir);
+    std::tie(interleave, io) = GetParam();
+    file = work_dir / fs::path("raw_cube_" +
+                               std::to_string(static_cast<int>(interleave)) +
+                               "_" + std::to_string(static_cast<int>(io)) +
+                               ".dat");
+  }
+
+  // writes the test cube band by band
+  void Write() {
+    hsp::RawCube cube(file.string(), kSamples, kLines, kBands, 12, interleave,
+                      io);
+    hsp::RawBandOutputIterator<uint16_t> out(&cube, 0);
+    for (int b = 0; b < kBands; ++b) {
+      cv::Mat band(kLines, kSamples, CV_16U);
+      for (int y = 0; y < kLines; ++y) {
+        for (int x = 0; x < kSamples; ++x) {
+          band.at<uint16_t>(y, x) = pixel(y, b, x);
+        }
+      }
+      *out++ = band;
+    }
+  }
+
+ protected:
+  const fs::path work_dir = fs::path("/tmp/hsp_unittest/");
+  fs::path file;
+  hsp::Interleave interleave;
+  hsp::RawIO io;
+};
+
+}  // namespace
+
+TEST_P(RawCubeTest, Slices) {
+  Write();
+  hsp::RawCube cube(file.string(), io);
+  EXPECT_EQ(cube.samples(), kSamples);
+  EXPECT_EQ(cube.lines(), kLines);
+  EXPECT_EQ(cube.bands(), kBands);
+  EXPECT_EQ(cube.interleave(), interleave);
+
+  using Iterator = hsp::RawLineInputIterator<uint16_t>;
+  static_assert(std::is_convertible<boost::iterator_traversal<Iterator>::type,
+                                    boost::random_access_traversal_tag>::value,
+                "random access traversal");
+  static_assert(
+      !std::is_convertible<std::iterator_traits<Iterator>::iterator_category,
+                           std::forward_iterator_tag>::value,
+      "slices are returned by value");
+  Iterator beg(&cube, 0), end(&cube, kLines);
+  ASSERT_EQ(end - beg, kLines);
+  EXPECT_THROW(*Iterator(), std::runtime_error);
+  for (auto it = beg; it != end; ++it) {
+    const cv::Mat line = *it;
+    ASSERT_EQ(line.rows, kBands);
+    ASSERT_EQ(line.cols, kSamples);
+    EXPECT_EQ(line.at<uint16_t>(2, 6), pixel(it.index(), 2, 6));
+  }
+  const cv::Mat sample = *hsp::RawSampleInputIterator<uint16_t>(&cube, 4);
+  ASSERT_EQ(sample.rows, kBands);
+  ASSERT_EQ(sample.cols, kLines);
+  EXPECT_EQ(sample.at<uint16_t>(1, 3), pixel(3, 1, 4));
+  EXPECT_THROW(cube.read(2, kLines), std::out_of_range);
+  EXPECT_THROW(hsp::RawLineInputIterator<float>(&cube, 0),
+               std::invalid_argument);
+}
+
+TEST_P(RawCubeTest, WriteSamples) {
+  Write();
+  {
+    hsp::RawCube cube(file.string(), io, true);
+    hsp::RawSampleOutputIterator<uint16_t> out(&cube, 2);
+    *out = cv::Mat(kBands, kLines, CV_16U, cv::Scalar(7));
+  }
+  hsp::RawCube cube(file.string(), io);
+  const cv::Mat line = cube.read(2, 1);
+  EXPECT_EQ(line.at<uint16_t>(0, 2), 7);
+  EXPECT_EQ(line.at<uint16_t>(0, 1), pixel(1, 0, 1));
+  EXPECT_EQ(line.at<uint16_t>(2, 3), pixel(1, 2, 3));
+  EXPECT_EQ(static_cast<std::size_t>(fs::file_size(file)),
+            sizeof(uint16_t) * kSamples * kLines * kBands);
+}
+
+TEST_P(RawCubeTest, ReadableByGDAL) {
+  Write();
+  GDALAllRegister();
+  auto dataset = GDALDatasetUniquePtr(
+      GDALDataset::FromHandle(GDALOpen(file.string().c_str(), GA_ReadOnly)));
+  ASSERT_NE(nullptr, dataset);
+  hsp::RawCube cube(file.string(), io);
+  hsp::LineInputIterator<uint16_t> it(dataset.get(), 0), end(dataset.get());
+  hsp::RawLineInputIterator<uint16_t> raw(&cube, 0);
+  for (; it != end; ++it, ++raw) {
+    EXPECT_EQ(cv::norm(*it, *raw, cv::NORM_INF), 0.0);
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    Layouts, RawCubeTest,
+    ::testing::Combine(::testing::Values(hsp::Interleave::BSQ,
+                                         hsp::Interleave::BIL,
+                                         hsp::Interleave::BIP),
+                       ::testing::Values(hsp::RawIO::Mapped, hsp::RawIO::Pread,
+                                         hsp::RawIO::Direct)));
+
+TEST(EnviHeaderTest, RoundTrip) {
+  const fs::path work_dir = fs::path("/tmp/hsp_unittest/");
+  fs::create_directories(work_dir);
+  const fs::path hdrfile = work_dir / fs::path("round_trip.hdr");
+  {
+    std::ofstream out(hdrfile.string());
+    out << "ENVI\n"
+        << "description = {test cube}\n"
+        << "samples = 7\nlines = 5\nbands = 2\n"
+        << "data type = 12\ninterleave = bil\n"
+        << "wavelength = {400, 500}\n"
+        << "band names = {\n  Band 1,\n  Band 2}\n"
+        << "sensor type = AHSI\n";
+  }
+  const hsp::EnviHeader header = hsp::read_envi_header(hdrfile.string());
+  EXPECT_EQ(header.fields.at("wavelength"), "400, 500");
+
+  const fs::path copied = work_dir / fs::path("round_trip_copy.hdr");
+  hsp::write_envi_header(copied.string(), header);
+  std::ifstream in(copied.string());
+  const std::string text((std::istreambuf_iterator<char>(in)),
+                         std::istreambuf_iterator<char>());
+  EXPECT_NE(text.find("wavelength = {400, 500}\n"), std::string::npos);
+  EXPECT_NE(text.find("sensor type = AHSI\n"), std::string::npos);
+
+  const hsp::EnviHeader reread = hsp::read_envi_header(copied.string());
+  for (auto&& key : {"description", "wavelength", "band names"}) {
+    EXPECT_EQ(reread.fields.at(key), header.fields.at(key)) << key;
+  }
+  EXPECT_EQ(reread.interleave, "bil");
+  EXPECT_EQ(reread.samples, 7);
+}
@@ -0,0 +1,144 @@
+// Copyright (C) 2026 Xiao Yunchen
+
+// GTest
+#include <gtest/gtest.h>
+
+// C++ Standard
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <vector>
+
+// project
+#include "../hsp/algorithm/simd.hpp"
+
+namespace {
+
+using hsp::simd::SimdLevel;
+
+const SimdLevel kVectorLevels[] = {SimdLevel::SSE41, SimdLevel::AVX2,
+                                   SimdLevel::AVX512};
+
+class SimdTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    std::mt19937 rng(2026);
+    std::uniform_int_distribution<int> dn(0, 65535);
+    std::uniform_real_distribution<float> coeff(-3.0f, 3.0f);
+    for (int i = 0; i < n; ++i) {
+      src[i] = static_cast<uint16_t>(dn(rng));
+      dark[i] = static_cast<uint16_t>(dn(rng));
+      dark_a[i] = coeff(rng);
+      dark_b[i] = coeff(rng) * 10000.0f;
+      gain[i] = coeff(rng);
+      offset[i] = coeff(rng) * 30000.0f;
+    }
+    // out-of-range and NaN coefficients must saturate like OpenCV
+    gain[3] = 1e30f;
+    offset[5] = std::numeric_limits<float>::quiet_NaN();
+    dark_b[7] = -1e30f;
+    dark_a[9] = std::numeric_limits<float>::quiet_NaN();
+  }
+
+  // not a multiple of any vector width, to cover the scalar tail
+  static constexpr int n = 1000 + 37;
+  std::vector<uint16_t> src = std::vector<uint16_t>(n);
+  std::vector<uint16_t> dark = std::vector<uint16_t>(n);
+  std::vector<float> dark_a = std::vector<float>(n);
+  std::vector<float> dark_b = std::vector<float>(n);
+  std::vector<float> gain = std::vector<float>(n);
+  std::vector<float> offset = std::vector<float>(n);
+};
+
+}  // namespace
+
+TEST_F(SimdTest, SubtractMatchesScalar) {
+  std::vector<uint16_t> expected(n), res(n);
+  hsp::simd::subtract_u16(src.data(), dark.data(), expected.data(), n,
+                          SimdLevel::Scalar);
+  for (int i = 0; i < n; ++i) {
+    ASSERT_EQ(expected[i], src[i] > dark[i] ? src[i] - dark[i] : 0);
+  }
+  for (auto level : kVectorLevels) {
+    hsp::simd::subtract_u16(src.data(), dark.data(), res.data(), n, level);
+    EXPECT_EQ(res, expected) << hsp::simd::level_name(level);
+  }
+}
+
+TEST_F(SimdTest, RadiometricMatchesScalar) {
+  std::vector<uint16_t> expected(n), res(n);
+  for (int with_dark = 0; with_dark < 2; ++with_dark) {
+    for (int with_gain = 0; with_gain < 2; ++with_gain) {
+      const float* a = with_dark ? dark_a.data() : nullptr;
+      const float* g = with_gain ? gain.data() : nullptr;
+      hsp::simd::radiometric_u16(src.data(), expected.data(), n, a,
+                                 dark_b.data(), 17.0f, g, offset.data(),
+                                 SimdLevel::Scalar);
+      for (auto level : kVectorLevels) {
+        hsp::simd::radiometric_u16(src.data(), res.data(), n, a, dark_b.data(),
+                                   17.0f, g, offset.data(), level);
+        EXPECT_EQ(res, expected)
+            << hsp::simd::level_name(level) << ", dark " << with_dark
+            << ", gain " << with_gain;
+      }
+    }
+  }
+}
+
+TEST_F(SimdTest, RadiometricInPlace) {
+  std::vector<uint16_t> expected(n), res(src);
+  hsp::simd::radiometric_u16(src.data(), expected.data(), n, dark_a.data(),
+                             dark_b.data(), 3.0f, gain.data(), offset.data());
+  hsp::simd::radiometric_u16(res.data(), res.data(), n, dark_a.data(),
+                             dark_b.data(), 3.0f, gain.data(), offset.data());
+  EXPECT_EQ(res, expected);
+}
+
+TEST_F(SimdTest, RadiometricSaturatesHugeValues) {
+  const float inf = std::numeric_limits<float>::infinity();
+  // dark terms beyond the int range must still clear the pixel
+  dark_b[0] = inf;
+  dark_b[1] = 1e10f;
+  dark_a[2] = 0.0f;
+  dark_b[2] = -inf;
+  // and gains beyond it must still saturate to 65535
+  for (int i = 10; i < 14; ++i) {
+    src[i] = 100;
+    dark_a[i] = 0.0f;
+    dark_b[i] = 0.0f;
+    offset[i] = 0.0f;
+  }
+  gain[10] = inf;
+  gain[11] = 1e10f;
+  offset[12] = 1e10f;
+  offset[13] = -inf;
+
+  std::vector<uint16_t> expected(n), res(n);
+  hsp::simd::radiometric_u16(src.data(), expected.data(), n, dark_a.data(),
+                             dark_b.data(), 17.0f, nullptr, nullptr,
+                             SimdLevel::Scalar);
+  EXPECT_EQ(expected[0], 0);
+  EXPECT_EQ(expected[1], 0);
+  EXPECT_EQ(expected[2], src[2]);
+  hsp::simd::radiometric_u16(src.data(), expected.data(), n, dark_a.data(),
+                             dark_b.data(), 17.0f, gain.data(), offset.data(),
+                             SimdLevel::Scalar);
+  EXPECT_EQ(expected[10], 65535);
+  EXPECT_EQ(expected[11], 65535);
+  EXPECT_EQ(expected[12], 65535);
+  EXPECT_EQ(expected[13], 0);
+
+  for (int with_gain = 0; with_gain < 2; ++with_gain) {
+    const float* g = with_gain ? gain.data() : nullptr;
+    hsp::simd::radiometric_u16(src.data(), expected.data(), n, dark_a.data(),
+                               dark_b.data(), 17.0f, g, offset.data(),
+                               SimdLevel::Scalar);
+    for (auto level : kVectorLevels) {
+      hsp::simd::radiometric_u16(src.data(), res.data(), n, dark_a.data(),
+                                 dark_b.data(), 17.0f, g, offset.data(), level);
+      EXPECT_EQ(res, expected)
+          << hsp::simd::level_name(level) << ", gain " << with_gain;
+    }
+  }
+}